@@ -0,0 +1,120 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <unordered_set>
+#include "AlgnJobScheduler.h"
+#include "BioSeq.h"
+
+// -----------------------------------------------------------------------------
+// AddSeqsToGeneAlgns
+// Ryan D. Crawford
+// 2020/11/16
+// -----------------------------------------------------------------------------
+// This function adds new gene sequences to the existing gene alignments in a
+// concatenated gene alignment. The alignment of each gene is extracted from
+// the concatenated alignment using the gene partitions, and the unique rows
+// are used as the reference the new sequences are aligned to with
+// "mafft --add --keeplength". The columns of the existing alignment are
+// unchanged, so the new rows can be appended to the concatenated alignment.
+// A list is returned with a named character vector containing the aligned
+// new sequences for each gene.
+// -----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+Rcpp::List AddSeqsToGeneAlgns(
+  const std::string        &algnPath,      // Path to the concatenated algn
+  const std::vector< int > &genePositions, // End positions of the genes
+  const Rcpp::List         &addSeqs,       // Sequences to add to each gene
+  const Rcpp::List         &addIds,        // Gene ids of the new sequences
+  const std::string        &algnDir,       // Directory for temporary files
+  const std::string        &mafftOpts,     // Arguments for mafft
+  int                      threadVal,      // Number of threads available
+  double                   maxMemMb        // Memory limit for concurrent jobs
+  )
+{
+  if ( addSeqs.size() != (int) genePositions.size() ||
+    addIds.size() != (int) genePositions.size() )
+    Rcpp::stop( "There must be sequences to add for each gene partition" );
+
+  // Read in the concatenated gene alignment
+  BioSeq concatAlgn( algnPath );
+  if ( !concatAlgn.parseFasta() )
+    Rcpp::stop( "Unable to read the alignment: " + algnPath );
+  std::vector< std::string > seqs = concatAlgn.getSeqs();
+
+  AlgnJobScheduler scheduler( algnDir, mafftOpts, threadVal, maxMemMb );
+
+  for ( unsigned int i = 0; i < genePositions.size(); i++ )
+  {
+    std::vector< std::string > newSeqs = Rcpp::as<
+      std::vector< std::string > >( addSeqs[ i ] );
+    std::vector< std::string > newIds  = Rcpp::as<
+      std::vector< std::string > >( addIds[ i ] );
+    if ( !newSeqs.size() ) continue;
+
+    // Find the partition of this gene in the concatenated alignment
+    int gStart = i == 0 ? 0 : genePositions[ i - 1 ];
+    int len    = genePositions[ i ] - gStart;
+
+    // Only the unique rows with at least one aligned residue are used as
+    // the reference for the new sequences
+    std::unordered_set< std::string > isObserved;
+    std::vector< std::string > refIds;
+    std::vector< std::string > refSeqs;
+    for ( auto &seq : seqs )
+    {
+      std::string geneAlgn = seq.substr( gStart, len );
+      if ( geneAlgn.find_first_not_of( '-' ) == std::string::npos ) continue;
+      if ( !isObserved.insert( geneAlgn ).second ) continue;
+
+      refIds.push_back( "cognac_ref_" + std::to_string( refSeqs.size() ) );
+      refSeqs.push_back( geneAlgn );
+    }
+
+    if ( refSeqs.size() )
+      scheduler.addJob( i + 1, refIds, refSeqs, newIds, newSeqs );
+  }
+
+  // Free the concatenated alignment before running mafft
+  seqs.clear();
+  concatAlgn.clearSeqs();
+
+  scheduler.runJobs();
+
+  std::vector< int > failed = scheduler.getFailedJobs();
+  if ( failed.size() )
+  {
+    std::string errStr = "mafft failed to add sequences to gene(s):";
+    for ( auto clustIdx : failed ) errStr += ' ' + std::to_string( clustIdx );
+    Rcpp::stop( errStr );
+  }
+
+  // Create the output list with only the new sequences for each gene
+  Rcpp::List algnList( genePositions.size() );
+  for ( unsigned int i = 0; i < genePositions.size(); i++ )
+    algnList[ i ] = Rcpp::CharacterVector( 0 );
+
+  for ( auto &job : scheduler.getJobs() )
+  {
+    std::unordered_set< std::string > isNewGene(
+      job.addIds.begin(), job.addIds.end() );
+
+    std::vector< std::string > algn;
+    std::vector< std::string > algnIds;
+    for ( unsigned int j = 0; j < job.algnIds.size(); j++ )
+    {
+      if ( isNewGene.count( job.algnIds[ j ] ) )
+      {
+        algn.push_back( job.algn[ j ] );
+        algnIds.push_back( job.algnIds[ j ] );
+      }
+    }
+
+    Rcpp::CharacterVector newAlgn = Rcpp::wrap( algn );
+    newAlgn.attr( "names" )       = Rcpp::wrap( algnIds );
+    algnList[ job.clustIdx - 1 ]  = newAlgn;
+  }
+
+  return algnList;
+}
+
+// -----------------------------------------------------------------------------
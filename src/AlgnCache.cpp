@@ -0,0 +1,141 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <unistd.h>
+#include "AlgnCache.h"
+#include "BioSeq.h"
+
+// -----------------------------------------------------------------------------
+// AlgnCache
+// Ryan D. Crawford
+// 2020/11/09
+// -----------------------------------------------------------------------------
+
+// Find the order of the sequences when sorted
+std::vector< size_t > AlgnCache::getSortedOrder(
+  const std::vector< std::string > &seqs
+  )
+{
+  std::vector< size_t > seqOrder( seqs.size() );
+  for ( size_t i = 0; i < seqs.size(); i++ ) seqOrder[ i ] = i;
+  std::sort( seqOrder.begin(), seqOrder.end(),
+    [&] ( size_t a, size_t b ) { return seqs[ a ] < seqs[ b ]; }
+    );
+  return seqOrder;
+}
+
+// Update a 64 bit FNV-1a hash with the input string
+void AlgnCache::updateHash( uint64_t &hash, const std::string &str )
+{
+  for ( auto ch : str )
+  {
+    hash ^= ( unsigned char ) ch;
+    hash *= 1099511628211ULL;
+  }
+
+  // Add a separator so the boundaries of the strings are part of the hash
+  hash ^= '\n';
+  hash *= 1099511628211ULL;
+}
+
+// Create the key for the sequences from the hash of the sorted sequences
+// and the mafft options
+std::string AlgnCache::getKey( const std::vector< std::string > &seqs,
+  const std::vector< size_t > &seqOrder
+  )
+{
+  // Two hashes with different offsets are combined into a 128 bit key
+  uint64_t fwdHash = 14695981039346656037ULL;
+  uint64_t altHash = 7809847782465536322ULL;
+
+  updateHash( fwdHash, mafftOpts );
+  updateHash( altHash, mafftOpts );
+  for ( auto i : seqOrder )
+  {
+    updateHash( fwdHash, seqs[ i ] );
+    updateHash( altHash, seqs[ i ] );
+  }
+
+  char key[ 33 ];
+  std::snprintf( key, sizeof( key ), "%016llx%016llx",
+    ( unsigned long long ) fwdHash, ( unsigned long long ) altHash );
+  return std::string( key );
+}
+
+// Return the path to the cache entry for a key
+std::string AlgnCache::getEntryPath( const std::string &key )
+{
+  return cacheDir + key + ".fasta";
+}
+
+// Look up the alignment of the input sequences. If an alignment is found,
+// "algn" is updated with the aligned sequences in the same order as the
+// input and true is returned
+bool AlgnCache::lookUp( const std::vector< std::string > &seqs,
+  std::vector< std::string > &algn
+  )
+{
+  std::vector< size_t > seqOrder = getSortedOrder( seqs );
+  std::string entryPath = getEntryPath( getKey( seqs, seqOrder ) );
+
+  // Check that there is an entry for this key
+  std::ifstream ifs( entryPath.c_str() );
+  if ( ifs.fail() ) return false;
+  ifs.close();
+
+  BioSeq bioSeq( entryPath );
+  if ( !bioSeq.parseFasta() ) return false;
+  std::vector< std::string > cached = bioSeq.getSeqs();
+  if ( cached.size() != seqs.size() ) return false;
+
+  // Check that each row is the input sequence once the gaps are removed
+  algn.resize( seqs.size() );
+  for ( size_t i = 0; i < seqOrder.size(); i++ )
+  {
+    std::string ungapped;
+    ungapped.reserve( cached[ i ].size() );
+    for ( auto ch : cached[ i ] ) if ( ch != '-' ) ungapped.push_back( ch );
+    if ( ungapped != seqs[ seqOrder[ i ] ] ) return false;
+
+    algn[ seqOrder[ i ] ] = cached[ i ];
+  }
+
+  return true;
+}
+
+// Add the alignment of the input sequences to the cache. The aligned
+// sequences must be in the same order as the input sequences
+bool AlgnCache::store( const std::vector< std::string > &seqs,
+  const std::vector< std::string > &algn
+  )
+{
+  if ( seqs.size() != algn.size() ) return false;
+
+  std::vector< size_t > seqOrder = getSortedOrder( seqs );
+  std::string entryPath = getEntryPath( getKey( seqs, seqOrder ) );
+
+  // Write the entry to a temporary file that is unique to this process and
+  // thread and rename it, so a partially written entry is never read
+  std::string tmpPath = entryPath + ".tmp" + std::to_string( getpid() ) +
+    '_' + std::to_string(
+      std::hash< std::thread::id >()( std::this_thread::get_id() ) );
+
+  std::ofstream ofs( tmpPath.c_str() );
+  if ( ofs.fail() ) return false;
+  for ( size_t i = 0; i < seqOrder.size(); i++ )
+    ofs << '>' << i << '\n' << algn[ seqOrder[ i ] ] << '\n';
+  ofs.close();
+  if ( ofs.fail() )
+  {
+    std::remove( tmpPath.c_str() );
+    return false;
+  }
+
+  return std::rename( tmpPath.c_str(), entryPath.c_str() ) == 0;
+}
+
+// -----------------------------------------------------------------------------
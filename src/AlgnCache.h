@@ -0,0 +1,68 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// AlgnCache
+// Ryan D. Crawford
+// 2020/11/09
+// -----------------------------------------------------------------------------
+// This class provides a content addressed cache for the alignments of the
+// gene clusters. Each entry is keyed by a hash of the sorted representative
+// sequences and the options passed to mafft, and is stored as a fasta file
+// in the cache directory. Rows are stored in the sorted order of the input
+// sequences, so the same set of sequences is found regardless of the order
+// or the names of the genes. When an entry is read, each row is checked
+// against the input sequences after removing gaps so a hash collision can
+// never return the wrong alignment.
+// -----------------------------------------------------------------------------
+
+#ifndef _ALGN_CACHE_
+#define _ALGN_CACHE_
+class AlgnCache
+{
+public:
+
+  // Value ctor: takes the directory with the cached alignments and the
+  // options passed to mafft
+  AlgnCache( const std::string &cacheDir, const std::string &mafftOpts ):
+    cacheDir( cacheDir ), mafftOpts( mafftOpts )
+  { ; }
+
+  // Look up the alignment of the input sequences. If an alignment is found,
+  // "algn" is updated with the aligned sequences in the same order as the
+  // input and true is returned
+  bool lookUp( const std::vector< std::string > &seqs,
+    std::vector< std::string > &algn );
+
+  // Add the alignment of the input sequences to the cache. The aligned
+  // sequences must be in the same order as the input sequences
+  bool store( const std::vector< std::string > &seqs,
+    const std::vector< std::string > &algn );
+
+private:
+
+  // Directory containing the cached alignments
+  std::string cacheDir;
+
+  // Options passed to mafft which are included in the key
+  std::string mafftOpts;
+
+  // Find the order of the sequences when sorted
+  std::vector< size_t > getSortedOrder(
+    const std::vector< std::string > &seqs );
+
+  // Create the key for the sequences from the hash of the sorted sequences
+  // and the mafft options
+  std::string getKey( const std::vector< std::string > &seqs,
+    const std::vector< size_t > &seqOrder );
+
+  // Return the path to the cache entry for a key
+  std::string getEntryPath( const std::string &key );
+
+  // Update a 64 bit FNV-1a hash with the input string
+  void updateHash( uint64_t &hash, const std::string &str );
+};
+#endif
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,187 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <algorithm>
+#include "AlgnColStats.h"
+
+// -----------------------------------------------------------------------------
+// AlgnColStats
+// Ryan D. Crawford
+// 2020/12/09
+// -----------------------------------------------------------------------------
+
+const size_t AlgnColStats::TILE_COLS;
+const size_t AlgnColStats::TILE_ROWS;
+
+AlgnColStats::AlgnColStats( const char *algnRows, const char *algnCols,
+  size_t numSeqs, size_t algnLen, AlgnAlphabet alphabet
+  ):
+  algnRows( algnRows ), algnCols( algnCols ), numSeqs( numSeqs ),
+  algnLen( algnLen ), alphabet( alphabet )
+{ ; }
+
+// Count the codes of the alphabet in a block of columns
+template< class Alphabet >
+void AlgnColStats::countBlock(
+  size_t cStart, size_t cEnd, uint32_t *counts
+  ) const
+{
+  const uint8_t *codes = Alphabet::getCodes();
+
+  // The columns are contiguous in the column-major alignment
+  if ( algnCols )
+  {
+    for ( size_t c = cStart; c < cEnd; c++ )
+    {
+      const char *col = algnCols + c * numSeqs;
+      uint32_t   *cnt = counts + ( c - cStart ) * Alphabet::NUM_CODES;
+      for ( size_t r = 0; r < numSeqs; r++ )
+        cnt[ codes[ (uint8_t) col[ r ] ] ]++;
+    }
+    return;
+  }
+
+  // Transpose a tile of rows at a time so the rows are read a cache line at
+  // a time and the columns are counted from contiguous memory
+  size_t nCols = cEnd - cStart;
+  char   tile[ TILE_COLS * TILE_ROWS ];
+  for ( size_t rStart = 0; rStart < numSeqs; rStart += TILE_ROWS )
+  {
+    size_t nRows = std::min( TILE_ROWS, numSeqs - rStart );
+    for ( size_t r = 0; r < nRows; r++ )
+    {
+      const char *row = algnRows + ( rStart + r ) * algnLen + cStart;
+      for ( size_t c = 0; c < nCols; c++ )
+        tile[ c * TILE_ROWS + r ] = row[ c ];
+    }
+
+    for ( size_t c = 0; c < nCols; c++ )
+    {
+      const char *col = tile + c * TILE_ROWS;
+      uint32_t   *cnt = counts + c * Alphabet::NUM_CODES;
+      for ( size_t r = 0; r < nRows; r++ )
+        cnt[ codes[ (uint8_t) col[ r ] ] ]++;
+    }
+  }
+}
+
+// Calculate the statistics of every column
+void AlgnColStats::calcColStats( double minGapFrac, unsigned int minSubThresh )
+{
+  if ( alphabet == ALPHABET_DNA )
+    calcAlphabetStats< DnaAlphabet >( minGapFrac, minSubThresh );
+  else calcAlphabetStats< ProteinAlphabet >( minGapFrac, minSubThresh );
+}
+
+// Calculate the statistics of every column with the alphabet
+template< class Alphabet >
+void AlgnColStats::calcAlphabetStats( double minGapFrac,
+  unsigned int minSubThresh
+  )
+{
+  gapFracs.assign( algnLen, 0 );
+  numMinorAlleles.assign( algnLen, 0 );
+  keepMask.assign( algnLen, 0 );
+
+  // Each block of columns is counted independently
+  const int numCodes  = Alphabet::NUM_CODES;
+  const int gapCode   = Alphabet::GAP_CODE;
+  size_t    numBlocks = ( algnLen + TILE_COLS - 1 ) / TILE_COLS;
+  tbb::parallel_for( size_t( 0 ), numBlocks, [&] ( size_t b )
+  {
+    size_t cStart = b * TILE_COLS;
+    size_t cEnd   = std::min( cStart + TILE_COLS, algnLen );
+
+    uint32_t counts[ TILE_COLS * numCodes ] = { 0 };
+    countBlock< Alphabet >( cStart, cEnd, counts );
+
+    for ( size_t c = cStart; c < cEnd; c++ )
+    {
+      const uint32_t *cnt = counts + ( c - cStart ) * numCodes;
+
+      // The minor alleles are the sequences without a gap that do not have
+      // the most common symbol
+      uint32_t numMajAllele = 0;
+      for ( int i = 0; i < numCodes; i++ )
+      {
+        if ( i != gapCode && cnt[ i ] > numMajAllele )
+          numMajAllele = cnt[ i ];
+      }
+      uint32_t numChars = numSeqs - cnt[ gapCode ];
+
+      gapFracs[ c ]        = numSeqs ? cnt[ gapCode ] / (double) numSeqs : 0;
+      numMinorAlleles[ c ] = numChars - numMajAllele;
+      keepMask[ c ]        = gapFracs[ c ] <= minGapFrac &&
+        (unsigned int) numMinorAlleles[ c ] >= minSubThresh;
+    }
+  });
+}
+
+// Count the pairs of sequences with different symbols at every column
+void AlgnColStats::calcMismatchPairs()
+{
+  if ( alphabet == ALPHABET_DNA ) calcAlphabetPairs< DnaAlphabet >();
+  else calcAlphabetPairs< ProteinAlphabet >();
+}
+
+// Count the pairs of sequences with different residues at every column with
+// the alphabet
+template< class Alphabet >
+void AlgnColStats::calcAlphabetPairs()
+{
+  mismatchPairs.assign( algnLen, 0 );
+
+  const int numCodes  = Alphabet::NUM_CODES;
+  size_t    numBlocks = ( algnLen + TILE_COLS - 1 ) / TILE_COLS;
+  tbb::parallel_for( size_t( 0 ), numBlocks, [&] ( size_t b )
+  {
+    size_t cStart = b * TILE_COLS;
+    size_t cEnd   = std::min( cStart + TILE_COLS, algnLen );
+
+    uint32_t counts[ TILE_COLS * numCodes ] = { 0 };
+    countBlock< Alphabet >( cStart, cEnd, counts );
+
+    // Every pair of sequences with a residue differs, unless both
+    // sequences have the same residue. The residues are the codes before
+    // the gap and the unknown residue
+    for ( size_t c = cStart; c < cEnd; c++ )
+    {
+      const uint32_t *cnt = counts + ( c - cStart ) * numCodes;
+      uint64_t numValid   = 0;
+      uint64_t numSame    = 0;
+      for ( int i = 0; i < Alphabet::NUM_RESIDUES; i++ )
+      {
+        numValid += cnt[ i ];
+        numSame  += (uint64_t) cnt[ i ] * ( cnt[ i ] - 1 ) / 2;
+      }
+      mismatchPairs[ c ] = numValid * ( numValid - 1 ) / 2 - numSame;
+    }
+  });
+}
+
+// Return the fraction of gaps in each column
+const std::vector< double > &AlgnColStats::getGapFracs() const
+{
+  return gapFracs;
+}
+
+// Return the number of sequences with a minor allele in each column
+const std::vector< int > &AlgnColStats::getNumMinorAlleles() const
+{
+  return numMinorAlleles;
+}
+
+// Return 1 for each column that passes the filters, 0 otherwise
+const std::vector< char > &AlgnColStats::getKeepMask() const
+{
+  return keepMask;
+}
+
+// Return the number of pairs of sequences that differ at each column
+const std::vector< uint64_t > &AlgnColStats::getMismatchPairs() const
+{
+  return mismatchPairs;
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,112 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+#include "Alphabet.h"
+
+// -----------------------------------------------------------------------------
+// AlgnColStats
+// Ryan D. Crawford
+// 2020/12/09
+// -----------------------------------------------------------------------------
+// This class calculates the statistics of every column in an alignment in a
+// single pass: the fraction of gaps, the number of sequences with a minor
+// allele and whether the column passes the filters to remain in the
+// alignment. The columns are processed in blocks in parallel. Within a
+// block, tiles of the row-major alignment are transposed into a small
+// buffer so each column is read contiguously, and the symbols are counted
+// in an array with one count for each code of the alphabet of the
+// alignment, 6 for nucleotides and 21 for amino acids. If the column-major
+// alignment is available the columns are counted in place. The residues
+// and the gap each have their own count, and 'N' and any other char are
+// counted as an unknown residue. The counting is a template on the
+// alphabet, so the size of the counts is known to the compiler. The counts
+// also give the number of pairs of sequences that differ at each column,
+// so the sum of the "raw" distances between every pair of sequences in a
+// partition is found without comparing the pairs.
+// -----------------------------------------------------------------------------
+
+#ifndef _ALGN_COL_STATS_
+#define _ALGN_COL_STATS_
+class AlgnColStats
+{
+public:
+
+  // Value ctor: takes a pointer to the row-major alignment, a pointer to the
+  // column-major alignment or null if it is not available, the number of
+  // sequences, the length of the alignment and its alphabet
+  AlgnColStats( const char *algnRows, const char *algnCols, size_t numSeqs,
+    size_t algnLen, AlgnAlphabet alphabet );
+
+  // Calculate the statistics of every column. A column is kept if the
+  // fraction of gaps is at most "minGapFrac" and there are at least
+  // "minSubThresh" sequences with a minor allele
+  void calcColStats( double minGapFrac, unsigned int minSubThresh );
+
+  // Count the pairs of sequences with different symbols at every column,
+  // excluding the pairs where either sequence has a gap or an unknown
+  // residue
+  void calcMismatchPairs();
+
+  // Return the fraction of gaps in each column
+  const std::vector< double > &getGapFracs() const;
+
+  // Return the number of sequences with a minor allele in each column
+  const std::vector< int > &getNumMinorAlleles() const;
+
+  // Return 1 for each column that passes the filters, 0 otherwise
+  const std::vector< char > &getKeepMask() const;
+
+  // Return the number of pairs of sequences that differ at each column
+  const std::vector< uint64_t > &getMismatchPairs() const;
+
+private:
+
+  // Number of columns in a tile
+  static const size_t TILE_COLS = 64;
+
+  // Number of rows in a tile
+  static const size_t TILE_ROWS = 256;
+
+  // Pointer to the row-major alignment
+  const char *algnRows;
+
+  // Pointer to the column-major alignment, null if not available
+  const char *algnCols;
+
+  // Number of sequences in the alignment
+  size_t numSeqs;
+
+  // Length of the alignment
+  size_t algnLen;
+
+  // Alphabet of the alignment
+  AlgnAlphabet alphabet;
+
+  // Fraction of gaps in each column
+  std::vector< double > gapFracs;
+
+  // Number of sequences with a minor allele in each column
+  std::vector< int > numMinorAlleles;
+
+  // 1 for each column that passes the filters
+  std::vector< char > keepMask;
+
+  // Number of pairs of sequences that differ at each column
+  std::vector< uint64_t > mismatchPairs;
+
+  // Count the codes of the alphabet in a block of columns
+  template< class Alphabet >
+  void countBlock( size_t cStart, size_t cEnd, uint32_t *counts ) const;
+
+  // Calculate the statistics of every column with the alphabet
+  template< class Alphabet >
+  void calcAlphabetStats( double minGapFrac, unsigned int minSubThresh );
+
+  // Count the pairs of sequences with different residues at every column
+  // with the alphabet
+  template< class Alphabet >
+  void calcAlphabetPairs();
+};
+#endif
+
+// -----------------------------------------------------------------------------
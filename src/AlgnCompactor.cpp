@@ -0,0 +1,133 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <algorithm>
+#include <cstring>
+#include "AlgnCompactor.h"
+
+// -----------------------------------------------------------------------------
+// AlgnCompactor
+// Ryan D. Crawford
+// 2020/12/10
+// -----------------------------------------------------------------------------
+
+AlgnCompactor::AlgnCompactor( const std::vector< char > &keepMask ):
+  algnLen( keepMask.size() ), newLen( 0 )
+{
+  // Find each run of consecutive kept columns
+  size_t i = 0;
+  while ( i < algnLen )
+  {
+    if ( !keepMask[ i ] )
+    {
+      i++;
+      continue;
+    }
+    size_t start = i;
+    while ( i < algnLen && keepMask[ i ] ) i++;
+    addRun( start, i );
+  }
+}
+
+AlgnCompactor::AlgnCompactor( const std::vector< int > &delStart,
+  const std::vector< int > &delEnd, size_t algnLen
+  ):
+  algnLen( algnLen ), newLen( 0 )
+{
+  // Sort the deleted intervals by their start, clipped to the alignment
+  std::vector< std::pair< size_t, size_t > > delIntervals;
+  for ( size_t i = 0; i < delStart.size(); i++ )
+  {
+    delIntervals.push_back( std::make_pair(
+      std::min< size_t >( std::max( delStart[ i ], 0 ), algnLen ),
+      std::min< size_t >( std::max( delEnd[ i ] + 1, 0 ), algnLen ) ) );
+  }
+  std::sort( delIntervals.begin(), delIntervals.end() );
+
+  // The runs of kept columns are the gaps between the deleted intervals
+  size_t curPos = 0;
+  for ( auto &interval : delIntervals )
+  {
+    if ( interval.first > curPos ) addRun( curPos, interval.first );
+    curPos = std::max( curPos, interval.second );
+  }
+  if ( curPos < algnLen ) addRun( curPos, algnLen );
+}
+
+// Add a run of kept columns
+void AlgnCompactor::addRun( size_t start, size_t end )
+{
+  runStarts.push_back( start );
+  runLens.push_back( end - start );
+  newStarts.push_back( newLen );
+  newLen += end - start;
+}
+
+// Return the length of the alignment after compaction
+size_t AlgnCompactor::getNewLen() const
+{
+  return newLen;
+}
+
+// Move the runs of a row to the start of the output row
+void AlgnCompactor::compactRow( const char *row, char *outRow ) const
+{
+  // The runs only move towards the start of the row, so moving them in
+  // order never overwrites a run that has not been moved
+  for ( size_t i = 0; i < runStarts.size(); i++ )
+  {
+    if ( outRow + newStarts[ i ] == row + runStarts[ i ] ) continue;
+    std::memmove( outRow + newStarts[ i ], row + runStarts[ i ], runLens[ i ] );
+  }
+}
+
+// Compact the rows of the alignment in place
+void AlgnCompactor::compact( std::vector< char > &algn, size_t numSeqs ) const
+{
+  // Compact each row within its own space in parallel
+  char *rows = algn.data();
+  tbb::parallel_for( size_t( 0 ), numSeqs, [&] ( size_t i )
+  {
+    compactRow( rows + i * algnLen, rows + i * algnLen );
+  });
+
+  // Then move the rows next to each other. Each row moves towards the start
+  // of the buffer into space that has already been moved
+  for ( size_t i = 1; i < numSeqs && newLen < algnLen; i++ )
+    std::memmove( rows + i * newLen, rows + i * algnLen, newLen );
+
+  algn.resize( numSeqs * newLen );
+}
+
+// Copy the compacted rows of the alignment into the output buffer
+void AlgnCompactor::compact(
+  const char *algn, char *outAlgn, size_t numSeqs
+  ) const
+{
+  tbb::parallel_for( size_t( 0 ), numSeqs, [&] ( size_t i )
+  {
+    compactRow( algn + i * algnLen, outAlgn + i * newLen );
+  });
+}
+
+// Remap the 1-based end positions of the partitions in the alignment
+void AlgnCompactor::remapPositions( std::vector< int > &endPositions ) const
+{
+  for ( auto &pos : endPositions )
+  {
+    // Find the last run that starts before the end of the partition. Every
+    // kept column up to the end of the partition remains in the partition
+    size_t endPos = std::max( pos, 0 );
+    auto it = std::lower_bound( runStarts.begin(), runStarts.end(), endPos );
+    if ( it == runStarts.begin() )
+    {
+      pos = 0;
+      continue;
+    }
+    size_t i = std::distance( runStarts.begin(), it ) - 1;
+    pos = newStarts[ i ] + std::min( runLens[ i ], endPos - runStarts[ i ] );
+  }
+}
+
+// -----------------------------------------------------------------------------
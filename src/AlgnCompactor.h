@@ -0,0 +1,74 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+
+// -----------------------------------------------------------------------------
+// AlgnCompactor
+// Ryan D. Crawford
+// 2020/12/10
+// -----------------------------------------------------------------------------
+// This class removes columns from a row-major alignment. The columns to keep
+// are given either as a mask or as the intervals of columns to delete, and
+// are converted once into a list of runs of consecutive kept columns. Each
+// row is then compacted by moving its runs, in parallel across the rows.
+// The alignment can be compacted in place or copied into a new buffer when
+// the input is read only. The end positions of the partitions in the
+// alignment are remapped from the same list of runs.
+// -----------------------------------------------------------------------------
+
+#ifndef _ALGN_COMPACTOR_
+#define _ALGN_COMPACTOR_
+class AlgnCompactor
+{
+public:
+
+  // Value ctor: takes a mask with 1 for each column to keep
+  AlgnCompactor( const std::vector< char > &keepMask );
+
+  // Value ctor: takes the 0-based start and end positions of the intervals
+  // to delete, inclusive, and the length of the alignment. The intervals
+  // may be in any order and may overlap
+  AlgnCompactor( const std::vector< int > &delStart,
+    const std::vector< int > &delEnd, size_t algnLen );
+
+  // Return the length of the alignment after compaction
+  size_t getNewLen() const;
+
+  // Compact the rows of the alignment in place. The buffer is resized to
+  // the compacted alignment
+  void compact( std::vector< char > &algn, size_t numSeqs ) const;
+
+  // Copy the compacted rows of the alignment into the output buffer, which
+  // must hold "numSeqs" rows of the new length
+  void compact( const char *algn, char *outAlgn, size_t numSeqs ) const;
+
+  // Remap the 1-based end positions of the partitions in the alignment to
+  // their positions after compaction
+  void remapPositions( std::vector< int > &endPositions ) const;
+
+private:
+
+  // Length of the alignment before compaction
+  size_t algnLen;
+
+  // Length of the alignment after compaction
+  size_t newLen;
+
+  // Start of each run of kept columns in the alignment
+  std::vector< size_t > runStarts;
+
+  // Length of each run of kept columns
+  std::vector< size_t > runLens;
+
+  // Start of each run in the compacted alignment
+  std::vector< size_t > newStarts;
+
+  // Add a run of kept columns
+  void addRun( size_t start, size_t end );
+
+  // Move the runs of a row to the start of the output row. The output may
+  // be the same row
+  void compactRow( const char *row, char *outRow ) const;
+};
+#endif
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,315 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include "AlgnFile.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// AlgnFile
+// Ryan D. Crawford
+// 2020/12/08
+// -----------------------------------------------------------------------------
+
+// Identifies the file as a binary alignment
+static const char ALGN_FILE_MAGIC[ 8 ] =
+  { 'C', 'G', 'N', 'A', 'L', 'G', 'N', 0 };
+
+// Version of the file format written by this class
+static const uint32_t ALGN_FILE_VERSION = 1;
+
+// Written as is so a file with the opposite byte order is detected
+static const uint32_t ALGN_FILE_BYTE_ORDER = 0x01020304;
+
+// Each section starts on a multiple of this size
+static const uint64_t ALGN_FILE_ALIGN = 64;
+
+// Size of the column-major blocks buffered when writing the file
+static const size_t ALGN_FILE_BLOCK_SIZE = 1 << 26;
+
+// Round an offset up to the start of the next section
+static uint64_t alignOffset( uint64_t offset )
+{
+  return ( offset + ALGN_FILE_ALIGN - 1 ) / ALGN_FILE_ALIGN * ALGN_FILE_ALIGN;
+}
+
+// Write zeros to the file up to the input offset
+static void padFile( std::ofstream &ofs, uint64_t &curOffset, uint64_t offset )
+{
+  static const char zeros[ ALGN_FILE_ALIGN ] = { 0 };
+  ofs.write( zeros, offset - curOffset );
+  curOffset = offset;
+}
+
+AlgnFile::AlgnFile(): data( nullptr ), dataSize( 0 ), header( nullptr )
+{ ; }
+
+AlgnFile::~AlgnFile()
+{
+  close();
+}
+
+// Return true if the file at the path is a binary alignment
+bool AlgnFile::isAlgnFile( const std::string &path )
+{
+  std::ifstream ifs( path.c_str(), std::ios::binary );
+  if ( ifs.fail() ) return false;
+
+  char magic[ sizeof( ALGN_FILE_MAGIC ) ];
+  if ( !ifs.read( magic, sizeof( magic ) ) ) return false;
+  return std::memcmp( magic, ALGN_FILE_MAGIC, sizeof( magic ) ) == 0;
+}
+
+// Write a binary alignment from a row-major buffer
+bool AlgnFile::write( const std::string &path,
+  const std::vector< std::string > &seqNames, const char *algnRows,
+  size_t numSeqs, size_t algnLen, const std::vector< int > &partitions,
+  bool addCols
+  )
+{
+  if ( seqNames.size() != numSeqs ) return false;
+
+  // Lay out the sections of the file
+  AlgnFileHeader header;
+  std::memset( &header, 0, sizeof( header ) );
+  std::memcpy( header.magic, ALGN_FILE_MAGIC, sizeof( header.magic ) );
+  header.version     = ALGN_FILE_VERSION;
+  header.byteOrder   = ALGN_FILE_BYTE_ORDER;
+  header.numSeqs     = numSeqs;
+  header.algnLen     = algnLen;
+  header.numParts    = partitions.size();
+  header.namesOffset = alignOffset( sizeof( header ) );
+  for ( auto &seqName : seqNames ) header.namesSize += seqName.size() + 1;
+  header.partsOffset = alignOffset( header.namesOffset + header.namesSize );
+  header.rowOffset   = alignOffset(
+    header.partsOffset + header.numParts * sizeof( int32_t ) );
+  if ( addCols )
+    header.colOffset = alignOffset( header.rowOffset + numSeqs * algnLen );
+
+  std::ofstream ofs( path.c_str(), std::ios::binary );
+  if ( ofs.fail() ) return false;
+
+  // Write the header, the names and the partitions
+  uint64_t curOffset = sizeof( header );
+  ofs.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+  padFile( ofs, curOffset, header.namesOffset );
+  for ( auto &seqName : seqNames )
+    ofs.write( seqName.c_str(), seqName.size() + 1 );
+  curOffset += header.namesSize;
+  padFile( ofs, curOffset, header.partsOffset );
+  for ( auto part : partitions )
+  {
+    int32_t partEnd = part;
+    ofs.write(
+      reinterpret_cast< const char * >( &partEnd ), sizeof( partEnd ) );
+  }
+  curOffset += header.numParts * sizeof( int32_t );
+
+  // Write the row-major alignment
+  padFile( ofs, curOffset, header.rowOffset );
+  ofs.write( algnRows, numSeqs * algnLen );
+  curOffset += numSeqs * algnLen;
+
+  // Transpose the alignment a block of columns at a time and write the
+  // column-major alignment. The rows are read in tiles so each tile of the
+  // block stays in cache while it is transposed
+  if ( addCols && numSeqs )
+  {
+    padFile( ofs, curOffset, header.colOffset );
+    const size_t TILE = 64;
+    size_t blockCols = std::max( ALGN_FILE_BLOCK_SIZE / numSeqs, TILE );
+    std::vector< char > colBuf( std::min( blockCols, algnLen ) * numSeqs );
+    for ( size_t cStart = 0; cStart < algnLen; cStart += blockCols )
+    {
+      size_t cEnd = std::min( cStart + blockCols, algnLen );
+      for ( size_t rTile = 0; rTile < numSeqs; rTile += TILE )
+      {
+        size_t rEnd = std::min( rTile + TILE, numSeqs );
+        for ( size_t cTile = cStart; cTile < cEnd; cTile += TILE )
+        {
+          size_t cTileEnd = std::min( cTile + TILE, cEnd );
+          for ( size_t r = rTile; r < rEnd; r++ )
+          {
+            const char *row = algnRows + r * algnLen;
+            for ( size_t c = cTile; c < cTileEnd; c++ )
+              colBuf[ ( c - cStart ) * numSeqs + r ] = row[ c ];
+          }
+        }
+      }
+      ofs.write( colBuf.data(), ( cEnd - cStart ) * numSeqs );
+    }
+  }
+  ofs.close();
+
+  return !ofs.fail();
+}
+
+// Open and map a binary alignment
+bool AlgnFile::open( const std::string &path )
+{
+  close();
+
+#ifndef _WIN32
+  int fd = ::open( path.c_str(), O_RDONLY );
+  if ( fd < 0 ) return false;
+
+  struct stat fileStat;
+  if ( fstat( fd, &fileStat ) != 0 ||
+       fileStat.st_size < (off_t) sizeof( AlgnFileHeader ) )
+  {
+    ::close( fd );
+    return false;
+  }
+
+  // The mapping stays valid after the file descriptor is closed
+  dataSize = fileStat.st_size;
+  void *addr = mmap( nullptr, dataSize, PROT_READ, MAP_SHARED, fd, 0 );
+  ::close( fd );
+  if ( addr == MAP_FAILED )
+  {
+    dataSize = 0;
+    return false;
+  }
+  data = static_cast< const char * >( addr );
+#else
+  std::ifstream ifs( path.c_str(), std::ios::binary | std::ios::ate );
+  if ( ifs.fail() ) return false;
+  fileBuf.resize( ifs.tellg() );
+  ifs.seekg( 0 );
+  if ( fileBuf.size() < sizeof( AlgnFileHeader ) ||
+       !ifs.read( fileBuf.data(), fileBuf.size() ) )
+  {
+    std::vector< char >().swap( fileBuf );
+    return false;
+  }
+  data     = fileBuf.data();
+  dataSize = fileBuf.size();
+#endif
+
+  header = reinterpret_cast< const AlgnFileHeader * >( data );
+  if ( !isValidHeader() )
+  {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+// Unmap the file
+void AlgnFile::close()
+{
+#ifndef _WIN32
+  if ( data ) munmap( const_cast< char * >( data ), dataSize );
+#else
+  std::vector< char >().swap( fileBuf );
+#endif
+  data     = nullptr;
+  dataSize = 0;
+  header   = nullptr;
+}
+
+// Check that the sections in the header are inside of the file
+bool AlgnFile::isValidHeader() const
+{
+  if ( std::memcmp( header->magic, ALGN_FILE_MAGIC, sizeof( header->magic ) ) ||
+       header->version != ALGN_FILE_VERSION ||
+       header->byteOrder != ALGN_FILE_BYTE_ORDER )
+    return false;
+
+  // Check the size of the alignment without overflowing
+  uint64_t algnSize = 0;
+  if ( header->algnLen )
+  {
+    if ( header->numSeqs > dataSize / header->algnLen ) return false;
+    algnSize = header->numSeqs * header->algnLen;
+  }
+
+  if ( header->namesOffset > dataSize ||
+       header->namesSize > dataSize - header->namesOffset ||
+       header->partsOffset > dataSize ||
+       header->numParts >
+         ( dataSize - header->partsOffset ) / sizeof( int32_t ) ||
+       header->rowOffset > dataSize ||
+       algnSize > dataSize - header->rowOffset )
+    return false;
+
+  if ( header->colOffset && ( header->colOffset > dataSize ||
+       algnSize > dataSize - header->colOffset ) )
+    return false;
+
+  // Check that there is a null terminated name for every sequence
+  const char *names = data + header->namesOffset;
+  if ( header->namesSize && names[ header->namesSize - 1 ] != '\0' )
+    return false;
+  uint64_t numNames = std::count( names, names + header->namesSize, '\0' );
+  if ( numNames != header->numSeqs ) return false;
+
+  return true;
+}
+
+// Return the number of sequences in the alignment
+size_t AlgnFile::getNumSeqs() const
+{
+  return header ? header->numSeqs : 0;
+}
+
+// Return the length of the alignment
+size_t AlgnFile::getAlgnLen() const
+{
+  return header ? header->algnLen : 0;
+}
+
+// Return the names of the sequences
+std::vector< std::string > AlgnFile::getSeqNames() const
+{
+  std::vector< std::string > seqNames;
+  if ( !header ) return seqNames;
+
+  seqNames.reserve( header->numSeqs );
+  const char *name     = data + header->namesOffset;
+  const char *namesEnd = name + header->namesSize;
+  while ( name < namesEnd )
+  {
+    seqNames.push_back( name );
+    name += seqNames.back().size() + 1;
+  }
+  return seqNames;
+}
+
+// Return the end position of each partition in the alignment
+std::vector< int > AlgnFile::getPartitions() const
+{
+  std::vector< int > partitions;
+  if ( !header ) return partitions;
+
+  partitions.resize( header->numParts );
+  for ( size_t i = 0; i < partitions.size(); i++ )
+  {
+    int32_t partEnd;
+    std::memcpy( &partEnd,
+      data + header->partsOffset + i * sizeof( int32_t ), sizeof( partEnd ) );
+    partitions[ i ] = partEnd;
+  }
+  return partitions;
+}
+
+// Return a pointer to the start of the row-major alignment
+const char *AlgnFile::getRows() const
+{
+  return header ? data + header->rowOffset : nullptr;
+}
+
+// Return a pointer to the start of the column-major alignment
+const char *AlgnFile::getCols() const
+{
+  return header && header->colOffset ? data + header->colOffset : nullptr;
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,132 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// AlgnFile
+// Ryan D. Crawford
+// 2020/12/08
+// -----------------------------------------------------------------------------
+// This class reads and writes the binary alignment format. The file starts
+// with a fixed size header, followed by the names of the sequences, the end
+// position of each partition in the alignment, the alignment stored with
+// one row per sequence and, optionally, the alignment stored with one column
+// per position. Each section starts on a 64 byte boundary. The file is
+// opened with mmap so the alignment is used in place without being parsed
+// or copied, and the pages are shared by every process reading the same
+// alignment. The row-major section is used by the pairwise distance
+// functions and the column-major section by the column statistics. On
+// Windows the file is read into memory instead.
+// -----------------------------------------------------------------------------
+
+#ifndef _ALGN_FILE_
+#define _ALGN_FILE_
+
+// The header at the start of the binary alignment. All offsets are in
+// bytes from the start of the file
+struct AlgnFileHeader
+{
+  // Identifies the file as a binary alignment
+  char magic[ 8 ];
+
+  // Version of the file format
+  uint32_t version;
+
+  // Used to check that the file was written with the same byte order
+  uint32_t byteOrder;
+
+  // Number of sequences in the alignment
+  uint64_t numSeqs;
+
+  // Length of the alignment
+  uint64_t algnLen;
+
+  // Number of partitions in the alignment
+  uint64_t numParts;
+
+  // Offset and size of the null terminated sequence names
+  uint64_t namesOffset;
+  uint64_t namesSize;
+
+  // Offset of the 32 bit partition end positions
+  uint64_t partsOffset;
+
+  // Offset of the row-major alignment
+  uint64_t rowOffset;
+
+  // Offset of the column-major alignment. Zero if there is no column-major
+  // section in the file
+  uint64_t colOffset;
+};
+
+class AlgnFile
+{
+public:
+
+  // Default ctor: no file is open
+  AlgnFile();
+
+  // Dtor: unmaps the file
+  ~AlgnFile();
+
+  // The mapped file cannot be shared between objects
+  AlgnFile( const AlgnFile & ) = delete;
+  AlgnFile &operator=( const AlgnFile & ) = delete;
+
+  // Return true if the file at the path is a binary alignment
+  static bool isAlgnFile( const std::string &path );
+
+  // Write a binary alignment from a row-major buffer with "numSeqs" rows of
+  // "algnLen" characters. If "addCols" is true the column-major section is
+  // also written. Returns true if the file was written.
+  static bool write( const std::string &path,
+    const std::vector< std::string > &seqNames, const char *algnRows,
+    size_t numSeqs, size_t algnLen, const std::vector< int > &partitions,
+    bool addCols );
+
+  // Open and map a binary alignment. Returns false if the file could not be
+  // opened or is not a valid binary alignment
+  bool open( const std::string &path );
+
+  // Unmap the file
+  void close();
+
+  // Return the number of sequences in the alignment
+  size_t getNumSeqs() const;
+
+  // Return the length of the alignment
+  size_t getAlgnLen() const;
+
+  // Return the names of the sequences
+  std::vector< std::string > getSeqNames() const;
+
+  // Return the end position of each partition in the alignment
+  std::vector< int > getPartitions() const;
+
+  // Return a pointer to the start of the row-major alignment
+  const char *getRows() const;
+
+  // Return a pointer to the start of the column-major alignment, or null if
+  // the file does not have a column-major section
+  const char *getCols() const;
+
+private:
+
+  // Pointer to the start of the mapped file
+  const char *data;
+
+  // Size of the mapped file
+  size_t dataSize;
+
+  // Header of the open file
+  const AlgnFileHeader *header;
+
+  // Buffer with the file contents where mmap is not available
+  std::vector< char > fileBuf;
+
+  // Check that the sections in the header are inside of the file
+  bool isValidHeader() const;
+};
+#endif
+
+// -----------------------------------------------------------------------------
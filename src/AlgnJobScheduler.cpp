@@ -0,0 +1,279 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <RcppParallel.h>
+#include "AlgnJobScheduler.h"
+
+// -----------------------------------------------------------------------------
+// AlgnJobScheduler
+// Ryan D. Crawford
+// 2020/11/02
+// -----------------------------------------------------------------------------
+
+AlgnJobScheduler::AlgnJobScheduler(
+  const std::string &algnDir, const std::string &mafftOpts, int numThreads,
+  double maxMemMb, const std::string &cacheDir, bool useFastAlgn
+  ):
+  mafftRunner( algnDir, mafftOpts ), numThreads( numThreads ),
+  maxMemMb( maxMemMb ), algnCache( cacheDir, mafftOpts ),
+  useCache( !cacheDir.empty() ), numCached( 0 ), useFastAlgn( useFastAlgn ),
+  numFastAlgn( 0 )
+{
+  if ( this->numThreads < 1 ) this->numThreads = 1;
+}
+
+// Add a gene cluster to be aligned
+void AlgnJobScheduler::addJob( int clustIdx,
+  const std::vector< std::string > &seqIds,
+  const std::vector< std::string > &seqs
+  )
+{
+  AlgnJob job;
+  job.clustIdx = clustIdx;
+  job.seqIds   = seqIds;
+  job.seqs     = seqs;
+  jobs.push_back( job );
+}
+
+// Add a job that adds new sequences to the existing alignment of a gene
+// cluster without changing the length of the alignment
+void AlgnJobScheduler::addJob( int clustIdx,
+  const std::vector< std::string > &seqIds,
+  const std::vector< std::string > &seqs,
+  const std::vector< std::string > &addIds,
+  const std::vector< std::string > &addSeqs
+  )
+{
+  addJob( clustIdx, seqIds, seqs );
+  jobs.back().addIds  = addIds;
+  jobs.back().addSeqs = addSeqs;
+}
+
+// Return a reference to the jobs in the order they were added
+std::vector< AlgnJob > &AlgnJobScheduler::getJobs()
+{
+  return jobs;
+}
+
+// Return the cluster indexes of any jobs that failed
+std::vector< int > AlgnJobScheduler::getFailedJobs()
+{
+  std::vector< int > failed;
+  for ( auto &job : jobs )
+    if ( !job.isAligned ) failed.push_back( job.clustIdx );
+  return failed;
+}
+
+// Return the number of jobs which were found in the cache
+int AlgnJobScheduler::getNumCached()
+{
+  return numCached;
+}
+
+// Return the number of jobs which were aligned without mafft
+int AlgnJobScheduler::getNumFastAlgn()
+{
+  return numFastAlgn;
+}
+
+// Look up each job in the cache and mark any jobs that were found as
+// aligned
+void AlgnJobScheduler::findCachedJobs()
+{
+  if ( !useCache ) return;
+
+  tbb::parallel_for_each( jobs.begin(), jobs.end(), [&] ( AlgnJob &job )
+  {
+    // Jobs adding sequences to an existing alignment are not cached
+    if ( job.addSeqs.size() ) return;
+
+    if ( algnCache.lookUp( job.seqs, job.algn ) )
+    {
+      job.algnIds   = job.seqIds;
+      job.isAligned = true;
+    }
+  });
+
+  for ( auto &job : jobs ) if ( job.isAligned ) numCached ++;
+}
+
+// Align the jobs with nearly identical genes without mafft and mark them
+// as aligned. These alignments are not added to the cache, since they are
+// cheaper to create than to read.
+void AlgnJobScheduler::runFastAlgnJobs()
+{
+  if ( !useFastAlgn ) return;
+
+  std::vector< char > isFastAlgn( jobs.size(), false );
+  tbb::parallel_for( size_t( 0 ), jobs.size(), [&] ( size_t i )
+  {
+    AlgnJob &job = jobs[ i ];
+    if ( job.isAligned || job.addSeqs.size() ) return;
+
+    if ( fastAligner.align( job.seqs, job.algn ) )
+    {
+      job.algnIds   = job.seqIds;
+      job.isAligned = true;
+      isFastAlgn[ i ] = true;
+    }
+  });
+
+  for ( auto isFast : isFastAlgn ) if ( isFast ) numFastAlgn ++;
+}
+
+// Estimate the cost and memory of each job, and sort the jobs that need
+// to be run from the largest to the smallest
+void AlgnJobScheduler::setJobBudgets()
+{
+  double totalCost = 0;
+
+  for ( auto &job : jobs )
+  {
+    if ( job.isAligned ) continue;
+
+    // Find the mean length of the sequences in the cluster
+    double n = job.seqs.size();
+    job.seqLen = 0;
+    for ( auto &seq : job.seqs ) job.seqLen += seq.size();
+    if ( n ) job.seqLen /= n;
+
+    // The distance calculation in mafft scales with the square of the number
+    // of sequences and the progressive alignment with the square of the
+    // sequence length. When adding to an existing alignment, each new
+    // sequence is compared to the existing sequences and aligned once.
+    if ( job.addSeqs.size() )
+      job.cost = job.addSeqs.size() * job.seqLen * ( n + job.seqLen );
+    else
+      job.cost = n * job.seqLen * ( n + job.seqLen );
+    totalCost += job.cost;
+  }
+
+  for ( auto &job : jobs )
+  {
+    if ( job.isAligned ) continue;
+
+    // Give each job enough threads that it is not expected to take longer
+    // than the whole set of jobs divided over the pool
+    if ( totalCost > 0 )
+      job.numThreads = std::ceil( job.cost * numThreads / totalCost );
+    if ( job.numThreads < 1 ) job.numThreads = 1;
+    if ( job.numThreads > numThreads ) job.numThreads = numThreads;
+
+    // Rough estimate of the memory used by mafft: the distance matrix, the
+    // dynamic programming matrix for each thread, and the sequences
+    double n   = job.seqs.size() + job.addSeqs.size();
+    double len = job.seqLen;
+    job.memMb  = ( 4.0 * n * n + 8.0 * len * len * job.numThreads +
+      2.0 * n * len ) / 1e6 + 16.0;
+  }
+
+  // Order the jobs from the largest to the smallest so the longest running
+  // jobs are not started last
+  jobOrder.clear();
+  for ( size_t i = 0; i < jobs.size(); i++ )
+    if ( !jobs[ i ].isAligned ) jobOrder.push_back( i );
+  std::stable_sort( jobOrder.begin(), jobOrder.end(),
+    [&] ( size_t a, size_t b ) { return jobs[ a ].cost > jobs[ b ].cost; }
+    );
+}
+
+// Run all of the jobs on the thread pool. Returns when every job is
+// finished
+void AlgnJobScheduler::runJobs()
+{
+  findCachedJobs();
+  runFastAlgnJobs();
+  setJobBudgets();
+
+  // Initialize the state of the pool
+  nextJob     = 0;
+  freeThreads = numThreads;
+  freeMemMb   = maxMemMb;
+  numRunning  = 0;
+
+  // There is no point in having more workers than there are jobs
+  int numWorkers = std::min< size_t >( numThreads, jobOrder.size() );
+
+  std::vector< std::thread > pool;
+  pool.reserve( numWorkers );
+  for ( int i = 0; i < numWorkers; i++ )
+    pool.push_back( std::thread( &AlgnJobScheduler::runWorker, this ) );
+
+  for ( auto &t : pool ) t.join();
+}
+
+// Function run by each thread in the pool. Takes the next job in the queue
+// when enough threads and memory are free to run it
+void AlgnJobScheduler::runWorker()
+{
+  while ( true )
+  {
+    AlgnJob *job;
+    {
+      std::unique_lock< std::mutex > lock( poolMtx );
+
+      // Wait until the job at the front of the queue fits in the threads
+      // and memory that are free. A job that exceeds the memory limit on
+      // its own is run when nothing else is running.
+      poolCv.wait( lock, [&] {
+        if ( nextJob >= jobOrder.size() ) return true;
+        AlgnJob &next = jobs[ jobOrder[ nextJob ] ];
+        bool hasMem = maxMemMb <= 0 || next.memMb <= freeMemMb ||
+          numRunning == 0;
+        return next.numThreads <= freeThreads && hasMem;
+      });
+
+      // If all of the jobs have been started, this worker is done
+      if ( nextJob >= jobOrder.size() ) return;
+
+      // Reserve the resources for this job
+      job = &jobs[ jobOrder[ nextJob ] ];
+      nextJob ++;
+      freeThreads -= job->numThreads;
+      freeMemMb   -= job->memMb;
+      numRunning ++;
+    }
+
+    job->isAligned = runJob( *job );
+    if ( job->isAligned && useCache && !job->addSeqs.size() ) storeJob( *job );
+
+    // Return the resources to the pool and wake the waiting workers
+    {
+      std::lock_guard< std::mutex > lock( poolMtx );
+      freeThreads += job->numThreads;
+      freeMemMb   += job->memMb;
+      numRunning --;
+    }
+    poolCv.notify_all();
+  }
+}
+
+// Align the sequences in a single job with mafft
+bool AlgnJobScheduler::runJob( AlgnJob &job )
+{
+  return mafftRunner.align( job.seqIds, job.seqs, job.addIds, job.addSeqs,
+    job.numThreads, job.algnIds, job.algn );
+}
+
+// Add the alignment of a finished job to the cache
+void AlgnJobScheduler::storeJob( const AlgnJob &job )
+{
+  // Put the aligned sequences in the same order as the input sequences
+  std::unordered_map< std::string, size_t > algnIdx;
+  for ( size_t i = 0; i < job.algnIds.size(); i++ )
+    algnIdx[ job.algnIds[ i ] ] = i;
+
+  std::vector< std::string > algn( job.seqs.size() );
+  for ( size_t i = 0; i < job.seqIds.size(); i++ )
+  {
+    auto it = algnIdx.find( job.seqIds[ i ] );
+    if ( it == algnIdx.end() ) return;
+    algn[ i ] = job.algn[ it->second ];
+  }
+
+  algnCache.store( job.seqs, algn );
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,169 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "AlgnCache.h"
+#include "MafftRunner.h"
+#include "CenterStarAligner.h"
+
+// -----------------------------------------------------------------------------
+// AlgnJobScheduler
+// Ryan D. Crawford
+// 2020/11/02
+// -----------------------------------------------------------------------------
+// This class schedules the alignment of each gene cluster with mafft on a
+// pool of native threads. Jobs are ordered from the largest to the smallest
+// cluster and each job is given a thread budget in proportion to its share
+// of the total work, so the largest clusters are aligned with multiple mafft
+// threads while small clusters are run concurrently on one thread each. The
+// number of jobs running at once is limited by the number of available
+// threads and by an estimate of the memory that mafft requires for each job.
+// Results are kept in the job objects, so the R session is never copied. If
+// a cache directory is supplied, alignments are looked up in the cache before
+// mafft is run and new alignments are added to the cache. mafft is run
+// without a shell, with the sequences streamed over pipes. Clusters of
+// nearly identical genes can be aligned natively with the center-star
+// aligner, so mafft is only run for the divergent clusters.
+// -----------------------------------------------------------------------------
+
+#ifndef _ALGN_JOB_
+#define _ALGN_JOB_
+struct AlgnJob
+{
+  // Index of the gene cluster in the list of clusters
+  int clustIdx;
+
+  // Ids and sequences of the representative genes to align
+  std::vector< std::string > seqIds;
+  std::vector< std::string > seqs;
+
+  // Ids and sequences of genes to add to an existing alignment. If there are
+  // sequences to add, "seqs" is the existing alignment and the new sequences
+  // are aligned to it with "mafft --add" keeping the length of the alignment
+  std::vector< std::string > addIds;
+  std::vector< std::string > addSeqs;
+
+  // The aligned sequences and the corresponding ids as output by mafft
+  std::vector< std::string > algnIds;
+  std::vector< std::string > algn;
+
+  // Mean length of the sequences in the cluster
+  double seqLen = 0;
+
+  // Estimated relative cost of aligning the cluster
+  double cost = 0;
+
+  // Estimated memory required by mafft in megabytes
+  double memMb = 0;
+
+  // Number of threads passed to mafft for this job
+  int numThreads = 1;
+
+  // Bool indicating that the alignment was created sucessfully
+  bool isAligned = false;
+};
+#endif
+
+#ifndef _ALGN_JOB_SCHEDULER_
+#define _ALGN_JOB_SCHEDULER_
+class AlgnJobScheduler
+{
+public:
+
+  // Value ctor: takes the directory for the temporary files created by
+  // mafft, the options passed to mafft, the number of threads available,
+  // the maximum memory to use for concurrent jobs (zero for no limit) and
+  // the directory of the alignment cache (empty to not use the cache) and
+  // a bool to align nearly identical clusters without mafft
+  AlgnJobScheduler( const std::string &algnDir, const std::string &mafftOpts,
+    int numThreads, double maxMemMb, const std::string &cacheDir = "",
+    bool useFastAlgn = false );
+
+  // Add a gene cluster to be aligned
+  void addJob( int clustIdx, const std::vector< std::string > &seqIds,
+    const std::vector< std::string > &seqs );
+
+  // Add a job that adds new sequences to the existing alignment of a gene
+  // cluster without changing the length of the alignment
+  void addJob( int clustIdx, const std::vector< std::string > &seqIds,
+    const std::vector< std::string > &seqs,
+    const std::vector< std::string > &addIds,
+    const std::vector< std::string > &addSeqs );
+
+  // Run all of the jobs on the thread pool. Returns when every job is
+  // finished
+  void runJobs();
+
+  // Return a reference to the jobs in the order they were added
+  std::vector< AlgnJob > &getJobs();
+
+  // Return the cluster indexes of any jobs that failed
+  std::vector< int > getFailedJobs();
+
+  // Return the number of jobs which were found in the cache
+  int getNumCached();
+
+  // Return the number of jobs which were aligned without mafft
+  int getNumFastAlgn();
+
+private:
+
+  // Runs mafft for each job without writing any fasta files
+  MafftRunner mafftRunner;
+
+  // Total number of threads and memory available to the pool
+  int    numThreads;
+  double maxMemMb;
+
+  // Cache of previously created alignments
+  AlgnCache algnCache;
+  bool      useCache;
+
+  // Number of jobs which were found in the cache
+  int numCached;
+
+  // Aligner for the clusters of nearly identical genes
+  CenterStarAligner fastAligner;
+  bool              useFastAlgn;
+
+  // Number of jobs which were aligned without mafft
+  int numFastAlgn;
+
+  // The jobs to run and the order to run them in
+  std::vector< AlgnJob > jobs;
+  std::vector< size_t >  jobOrder;
+
+  // Shared state of the pool, guarded by the mutex
+  std::mutex              poolMtx;
+  std::condition_variable poolCv;
+  size_t                  nextJob;
+  int                     freeThreads;
+  double                  freeMemMb;
+  int                     numRunning;
+
+  // Look up each job in the cache and mark any jobs that were found as
+  // aligned
+  void findCachedJobs();
+
+  // Align the jobs with nearly identical genes without mafft and mark
+  // them as aligned
+  void runFastAlgnJobs();
+
+  // Estimate the cost and memory of each job, and sort the jobs that need
+  // to be run from the largest to the smallest
+  void setJobBudgets();
+
+  // Function run by each thread in the pool. Takes the next job in the queue
+  // when enough threads and memory are free to run it
+  void runWorker();
+
+  // Align the sequences in a single job with mafft
+  bool runJob( AlgnJob &job );
+
+  // Add the alignment of a finished job to the cache
+  void storeJob( const AlgnJob &job );
+};
+#endif
+
+// -----------------------------------------------------------------------------
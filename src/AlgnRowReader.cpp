@@ -0,0 +1,161 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <fstream>
+#include <algorithm>
+#include "AlgnRowReader.h"
+
+// -----------------------------------------------------------------------------
+// AlgnRowReader
+// Ryan D. Crawford
+// 2020/12/15
+// -----------------------------------------------------------------------------
+
+// Size of the buffer used to scan the fasta alignment
+static const size_t FASTA_SCAN_SIZE = 1 << 20;
+
+// Find the names and the length of the sequences in the alignment
+void AlgnRowReader::indexAlgn()
+{
+  // A binary alignment is mapped and used without indexing
+  if ( AlgnFile::isAlgnFile( faPath ) )
+  {
+    if ( !algnFile.open( faPath ) )
+      Rcpp::stop( "Unable to open the binary alignment for reading\n" );
+    algnLen  = algnFile.getAlgnLen();
+    seqNames = algnFile.getSeqNames();
+  }
+  else
+  {
+    indexFasta();
+  }
+
+  if ( !algnLen || seqNames.empty() )
+    Rcpp::stop( "There are no sequences in this alignment...\n" );
+}
+
+// Scan the fasta alignment for the names and offsets of the sequences
+void AlgnRowReader::indexFasta()
+{
+  faStream.open( faPath.c_str(), std::ios::binary );
+  if ( faStream.fail() )
+    Rcpp::stop( "Unable to open the alignment for reading\n" );
+
+  // Scan the file one buffer at a time. Each line starting with '>' is a
+  // header, and the length of a sequence is the number of characters on
+  // the lines following its header
+  std::vector< char > scanBuf( FASTA_SCAN_SIZE );
+  std::string header;
+  bool        isHeader    = false;
+  bool        isLineStart = true;
+  size_t      seqLen      = 0;
+  uint64_t    fileOffset  = 0;
+  while ( faStream.read( scanBuf.data(), scanBuf.size() ) ||
+          faStream.gcount() )
+  {
+    size_t numRead = faStream.gcount();
+    for ( size_t i = 0; i < numRead; i++, fileOffset++ )
+    {
+      char ch = scanBuf[ i ];
+      if ( isLineStart && ch == '>' )
+      {
+        // Check the length of the previous sequence
+        if ( seqOffsets.size() && seqLen != algnLen )
+          Rcpp::stop( "The alignments must be the same length...\n" );
+        isHeader = true;
+        header.clear();
+      }
+      else if ( ch == '\n' )
+      {
+        // The sequence starts on the line after the header
+        if ( isHeader )
+        {
+          seqNames.push_back( getSeqName( header ) );
+          seqOffsets.push_back( fileOffset + 1 );
+          isHeader = false;
+          seqLen   = 0;
+        }
+      }
+      else if ( isHeader )
+      {
+        header += ch;
+      }
+      else
+      {
+        if ( seqOffsets.empty() )
+          Rcpp::stop( "The alignment is not a valid fasta file\n" );
+
+        // Like the parsed alignment, the alignment is converted to
+        // uppercase if the first sequence starts with a lowercase letter
+        if ( seqOffsets.size() == 1 && seqLen == 0 )
+          isLower = std::islower( ch );
+        seqLen++;
+        if ( seqOffsets.size() == 1 ) algnLen = seqLen;
+      }
+      isLineStart = ch == '\n';
+    }
+  }
+
+  // A header on the last line of the file has an empty sequence
+  if ( isHeader )
+  {
+    seqNames.push_back( getSeqName( header ) );
+    seqOffsets.push_back( fileOffset );
+    seqLen = 0;
+  }
+  if ( seqOffsets.size() && seqLen != algnLen )
+    Rcpp::stop( "The alignments must be the same length...\n" );
+  faStream.clear();
+}
+
+// Returns the number of sequences in the alignment
+size_t AlgnRowReader::getNumSeqs() const
+{
+  return seqNames.size();
+}
+
+// Returns the length of the alignment
+size_t AlgnRowReader::getAlgnLen() const
+{
+  return algnLen;
+}
+
+// Set "rows" to pointers to the sequences of a block
+void AlgnRowReader::readRows( size_t start, size_t count,
+  std::vector< char > &rowBuf, std::vector< const char * > &rows
+  )
+{
+  if ( start + count > getNumSeqs() )
+    Rcpp::stop( "The rows are not inside of the alignment" );
+  rows.resize( count );
+
+  // The rows of a binary alignment are used in place
+  if ( algnFile.getRows() )
+  {
+    for ( size_t i = 0; i < count; i++ )
+      rows[ i ] = algnFile.getRows() + ( start + i ) * algnLen;
+    return;
+  }
+
+  // Read the lines of each sequence until the row is full
+  rowBuf.resize( count * algnLen );
+  std::string line;
+  for ( size_t i = 0; i < count; i++ )
+  {
+    char  *row    = rowBuf.data() + i * algnLen;
+    size_t rowLen = 0;
+    faStream.clear();
+    faStream.seekg( seqOffsets[ start + i ] );
+    while ( rowLen < algnLen && getline( faStream, line ) )
+    {
+      size_t lineLen = std::min( line.size(), algnLen - rowLen );
+      std::copy( line.begin(), line.begin() + lineLen, row + rowLen );
+      rowLen += lineLen;
+    }
+    if ( rowLen != algnLen )
+      Rcpp::stop( "Unable to read sequence " + seqNames[ start + i ] );
+    if ( isLower ) std::transform( row, row + algnLen, row, ::toupper );
+    rows[ i ] = row;
+  }
+}
+
+// -----------------------------------------------------------------------------
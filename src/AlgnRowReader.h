@@ -0,0 +1,72 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <fstream>
+#include "BioSeq.h"
+#include "AlgnFile.h"
+
+// -----------------------------------------------------------------------------
+// AlgnRowReader
+// Ryan D. Crawford
+// 2020/12/15
+// -----------------------------------------------------------------------------
+// This class reads blocks of rows from an alignment without holding the
+// whole alignment in memory. A binary alignment is mapped and the rows are
+// used in place, so the pages of the rows that are not in use are dropped
+// by the operating system. A fasta alignment is first scanned once to find
+// the names of the sequences and the offset of each sequence in the file,
+// then the sequences of a block are read from their offsets when the block
+// is requested.
+// -----------------------------------------------------------------------------
+
+#ifndef _ALGN_ROW_READER_
+#define _ALGN_ROW_READER_
+class AlgnRowReader : public BioSeq
+{
+public:
+
+  // Value ctor: assigns the path to the alignment in fasta or binary
+  // format. The alignment is not read until it is indexed
+  AlgnRowReader( const std::string &msaPath ): BioSeq( msaPath ),
+    algnLen( 0 ), isLower( false )
+  { ; }
+
+  // Find the names and the length of the sequences in the alignment. Stops
+  // with an error if the alignment can not be read or the sequences are
+  // not the same length
+  void indexAlgn();
+
+  // Returns the number of sequences in the alignment
+  size_t getNumSeqs() const;
+
+  // Returns the length of the alignment
+  size_t getAlgnLen() const;
+
+  // Set "rows" to pointers to the "count" sequences starting at "start".
+  // The sequences of a fasta alignment are read into "rowBuf"
+  void readRows( size_t start, size_t count, std::vector< char > &rowBuf,
+    std::vector< const char * > &rows );
+
+private:
+
+  // The mapped binary alignment
+  AlgnFile algnFile;
+
+  // The length of the alignment
+  size_t algnLen;
+
+  // Offset of the first line of each sequence in a fasta alignment
+  std::vector< uint64_t > seqOffsets;
+
+  // Bool indicating that the fasta alignment is lowercase and is
+  // converted to uppercase when it is read
+  bool isLower;
+
+  // File stream of the fasta alignment
+  std::ifstream faStream;
+
+  // Scan the fasta alignment for the names and offsets of the sequences
+  void indexFasta();
+};
+#endif
+
+// -----------------------------------------------------------------------------
@@ -1,5 +1,8 @@
+// [[Rcpp::depends(RcppParallel)]]
 // [[Rcpp::plugins(cpp11)]]
 #include <Rcpp.h>
+#include <RcppParallel.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <cmath>
 #include "AlgnSubCalc.h"
 using namespace Rcpp;
@@ -27,6 +30,11 @@ AlgnSubCalc::AlgnSubCalc()
   for ( unsigned int i = 0; i < aaCodes.size(); i++ )
     aaIdxs.insert( std::pair< char, int >( aaCodes[i], i ) );
 
+  // Create the table to look up the indices while counting the columns
+  std::fill( aaLookup, aaLookup + 256, -1 );
+  for ( unsigned int i = 0; i < aaCodes.size(); i++ )
+    aaLookup[ (unsigned char) aaCodes[ i ] ] = i;
+
   // Set number of rows and columns to attribute dim
   subMat = NumericMatrix( aaCodes.size(), aaCodes.size() );
 
@@ -41,16 +49,6 @@ Rcpp::NumericMatrix AlgnSubCalc::getSubMat()
   return subMat;
 }
 
-void AlgnSubCalc::countAaCodes( const std::string &seq )
-{
-  // For each amino acid in the alignment, increment the count
-  for ( auto it = seq.begin(); it != seq.end(); it++ )
-  {
-    auto aaCount = aaCounts.find( *it );
-    if ( aaCount != aaCounts.end() ) aaCount->second ++;
-  }
-}
-
 bool AlgnSubCalc::getAaIdx( char aa, unsigned int &idx )
 {
   auto it = aaIdxs.find( aa );
@@ -63,17 +61,96 @@ void AlgnSubCalc::updateSubMat(
   const std::vector< std::string > &seqs
   )
 {
-  // For each sequence get the frequency of each amino acid and the
-  // frequeny at which an amino acid is mutated
-  unsigned int numSeqs = seqs.size();
-  for ( unsigned int i = 0; i < numSeqs; i++ )
+  // Get a pointer to each sequence. The sequences in an alignment are all
+  // the length of the first sequence
+  std::vector< const char * > seqPtrs;
+  for ( auto &seq : seqs ) seqPtrs.push_back( seq.c_str() );
+  for ( auto &seq : seqs )
   {
-    // Count the frequency of each amino acid in this sequence
-    countAaCodes( seqs[i] );
+    if ( seq.size() != seqs[ 0 ].size() )
+      Rcpp::stop( "The alignments must be the same length...\n" );
+  }
 
-    // For each Additional sequence,
-    for ( unsigned int j = i + 1; j < numSeqs; j++ )
-      countSubs( seqs[ i ], seqs[ j ] );
+  updateSubMat( seqPtrs, seqs.size() ? seqs[ 0 ].size() : 0 );
+}
+
+const int    AlgnSubCalc::NUM_AAS;
+const size_t AlgnSubCalc::SUB_TILE_COLS;
+
+void AlgnSubCalc::updateSubMat(
+  const std::vector< const char * > &seqs, size_t len
+  )
+{
+  // Count blocks of columns in parallel. Each thread adds to its own amino
+  // acid counts and substitution matrix, which are summed at the end
+  typedef std::vector< uint64_t > Totals;
+  tbb::enumerable_thread_specific< Totals > aaTotals( Totals( NUM_AAS, 0 ) );
+  tbb::enumerable_thread_specific< Totals > subTotals(
+    Totals( NUM_AAS * NUM_AAS, 0 ) );
+  size_t numBlocks = ( len + SUB_TILE_COLS - 1 ) / SUB_TILE_COLS;
+  tbb::parallel_for( size_t( 0 ), numBlocks, [&] ( size_t b )
+  {
+    size_t cStart = b * SUB_TILE_COLS;
+    size_t cEnd   = std::min( cStart + SUB_TILE_COLS, len );
+    countColumns( seqs, cStart, cEnd, aaTotals.local().data(),
+      subTotals.local().data() );
+  });
+
+  // Add the counts of every thread to the amino acid counts and the
+  // substitution matrix
+  for ( auto &totals : aaTotals )
+  {
+    for ( auto it = aaCounts.begin(); it != aaCounts.end(); it++ )
+      it->second += totals[ aaLookup[ (unsigned char) it->first ] ];
+  }
+  for ( auto &totals : subTotals )
+  {
+    for ( int i = 0; i < NUM_AAS; i++ )
+      for ( int j = 0; j < NUM_AAS; j++ )
+        subMat( i, j ) += totals[ i * NUM_AAS + j ];
+  }
+}
+
+void AlgnSubCalc::countColumns( const std::vector< const char * > &seqs,
+  size_t cStart, size_t cEnd, uint64_t *aaTotals, uint64_t *subTotals
+  ) const
+{
+  // Count the amino acids in each column, reading each sequence in order
+  uint32_t counts[ SUB_TILE_COLS * NUM_AAS ] = { 0 };
+  for ( auto seq : seqs )
+  {
+    for ( size_t c = cStart; c < cEnd; c++ )
+    {
+      int idx = aaLookup[ (unsigned char) seq[ c ] ];
+      if ( idx >= 0 ) counts[ ( c - cStart ) * NUM_AAS + idx ]++;
+    }
+  }
+
+  // Each pair of sequences with amino acids a and b adds a substitution at
+  // ( a, b ) and ( b, a ), so a pair with the same amino acid adds two to
+  // the diagonal. Only the amino acids in the column are paired
+  int nIdx = aaLookup[ (unsigned char) 'N' ];
+  for ( size_t c = 0; c < cEnd - cStart; c++ )
+  {
+    const uint32_t *cnt = counts + c * NUM_AAS;
+    int numPresent = 0;
+    int present[ NUM_AAS ];
+    for ( int i = 0; i < NUM_AAS; i++ )
+    {
+      if ( !cnt[ i ] ) continue;
+      aaTotals[ i ] += cnt[ i ];
+      if ( i != nIdx ) present[ numPresent++ ] = i;
+    }
+    for ( int a = 0; a < numPresent; a++ )
+    {
+      uint64_t aCount = cnt[ present[ a ] ];
+      uint64_t *row   = subTotals + present[ a ] * NUM_AAS;
+      for ( int b = 0; b < numPresent; b++ )
+      {
+        row[ present[ b ] ] += a == b ? aCount * ( aCount - 1 ) :
+          aCount * cnt[ present[ b ] ];
+      }
+    }
   }
 }
 
@@ -88,7 +165,7 @@ void AlgnSubCalc::calcSubProbabilities()
   //   Rcout << std::endl;
   // }
 
-  double numSubs;
+  double numSubs = 0;
   for ( unsigned int i = 0; i < subMat.nrow(); i++ )
     for ( unsigned int j = 0; j < subMat.ncol(); j++ )
       numSubs += subMat( i, j );
@@ -177,24 +254,33 @@ void AlgnSubCalc::calcNormalizedProbs()
   }
 }
 
-void AlgnSubCalc::countSubs( const std::string &ref, const std::string &qry )
+const int AlgnSubCalc::NUM_SCORE_CODES;
+const int AlgnSubCalc::UNSCORED_CODE;
+
+// Encode a sequence with the code of each char
+void AlgnSubCalc::encodeSeq( const char *seq, size_t len, char *codes ) const
 {
-  unsigned int rIdx;
-  unsigned int qIdx;
+  for ( size_t i = 0; i < len; i++ )
+  {
+    int idx = aaLookup[ (unsigned char) seq[ i ] ];
+    codes[ i ] = idx < 0 ? UNSCORED_CODE : idx;
+  }
+}
 
-  for ( unsigned int i = 0; i < ref.size(); i++ )
+// Return the table of the substitution matrix indexed by the pair of codes
+std::vector< double > AlgnSubCalc::getScoreTable( bool skipMatches )
+{
+  std::vector< double > scoreTable( NUM_SCORE_CODES * NUM_SCORE_CODES, 0 );
+  int nIdx = aaLookup[ (unsigned char) 'N' ];
+  for ( int i = 0; i < NUM_AAS; i++ )
   {
-    // If this position in the reference is not the same as the
-    // query..
-    if ( ref[i] != '-' && qry[i] != '-' && ref[i] != 'N' &&  qry[i] != 'N' )
+    for ( int j = 0; j < NUM_AAS; j++ )
     {
-      if ( getAaIdx( ref[i], rIdx ) && getAaIdx( qry[i], qIdx ) )
-      {
-        subMat( rIdx, qIdx ) ++;
-        subMat( qIdx, rIdx ) ++;
-      }
+      if ( i == nIdx || j == nIdx || ( skipMatches && i == j ) ) continue;
+      scoreTable[ i * NUM_SCORE_CODES + j ] = subMat( i, j );
     }
   }
+  return scoreTable;
 }
 
 double AlgnSubCalc::getSubPr( char rCh, char qCh )
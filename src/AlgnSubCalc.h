@@ -1,6 +1,7 @@
 // [[Rcpp::plugins(cpp11)]]
 #include <Rcpp.h>
 #include <cmath>
+#include <cstdint>
 using namespace Rcpp;
 
 // -----------------------------------------------------------------------------
@@ -11,6 +12,11 @@ using namespace Rcpp;
 // This is an "alignment substitution calculator" class object which has
 // functionality for calculating a substituion matrix to calcuate the
 // probability of substitutions between pairs of amino acids. 
+// The substitutions are not counted pair by pair. Within a column of the
+// alignment the number of pairs with symbols a and b is the product of the
+// counts of a and b, or count * ( count - 1 ) / 2 pairs when a = b, so the
+// matrix is accumulated from the symbol counts of each column. Blocks of
+// columns are counted in parallel into a matrix local to each thread.
 // -----------------------------------------------------------------------------
 
 #ifndef _ALGN_SUB_CALC_
@@ -25,6 +31,10 @@ public:
   // Update the substitiution matrix with the input alignment
   void updateSubMat( const std::vector< std::string > &seqs );
 
+  // Update the substitiution matrix with the alignment from pointers to
+  // the start of each sequence and the length of the alignment
+  void updateSubMat( const std::vector< const char * > &seqs, size_t len );
+
   // Return the subsitiution matrix with the alignment
   Rcpp::NumericMatrix getSubMat();
 
@@ -38,6 +48,22 @@ public:
   // Calculate the log normalized substitution probabilities
   void calcNormalizedProbs();
 
+  // Number of codes of an encoded sequence. Each amino acid is coded by its
+  // row/column index and every other char by UNSCORED_CODE
+  static const int NUM_SCORE_CODES = 32;
+
+  // Code of the chars that are not amino acids
+  static const int UNSCORED_CODE = 20;
+
+  // Encode a sequence with the code of each char
+  void encodeSeq( const char *seq, size_t len, char *codes ) const;
+
+  // Return the flat table of the value of the substitution matrix for each
+  // pair of codes, indexed by refCode * NUM_SCORE_CODES + qryCode. Pairs
+  // with an 'N' or a char that is not an amino acid are zero, as are pairs
+  // with the same amino acid if "skipMatches" is true
+  std::vector< double > getScoreTable( bool skipMatches );
+
 private:
 
   // Map of amino acids to their frequency
@@ -52,13 +78,22 @@ private:
   // Bool indicating if the matrix has been normalized
   bool isNormalized = false;
 
-  // Count the chars in a sequence
-  void countAaCodes( const std::string &seq );
+  // Number of amino acid symbols
+  static const int NUM_AAS = 20;
+
+  // Number of columns counted at a time by a thread
+  static const size_t SUB_TILE_COLS = 256;
+
+  // Row/column index of each char, -1 if the char is not an amino acid
+  int aaLookup[ 256 ];
 
-  // Count the amino acid substitutions between two sequences. The counts
-  // for each amino acid are incrementd for each char in the reference
-  // sequence.
-  void countSubs( const std::string &ref, const std::string &qry );
+  // Count the amino acids in the columns from "cStart" to "cEnd" and add
+  // the amino acid counts and the substitutions between every pair of
+  // sequences in the columns. 'N' is counted as an amino acid but is not
+  // counted in the substitutions
+  void countColumns( const std::vector< const char * > &seqs,
+    size_t cStart, size_t cEnd, uint64_t *aaTotals, uint64_t *subTotals
+    ) const;
 
   // Look up the row/column index of the input char. If this is a valid aa/nt
   // symbol true is returned and the "idx" variable is updated.
@@ -0,0 +1,126 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <cstring>
+#include <cctype>
+#include "Alphabet.h"
+
+// -----------------------------------------------------------------------------
+// Alphabet
+// Ryan D. Crawford
+// 2020/12/17
+// -----------------------------------------------------------------------------
+
+// The residues of each alphabet in the order of their codes
+static const char DNA_RESIDUES[]     = "ACGT";
+// The amino acids without 'N', which is treated as a missing residue in
+// every alignment
+static const char PROTEIN_RESIDUES[] = "ACDEFGHIKLMPQRSTVWY";
+
+// The letters of a nucleotide alignment, not counting the ambiguity codes
+static const char NUCLEOTIDES[] = "ACGTUN";
+
+// Table with the code of each char of an alphabet
+struct CodeTable
+{
+  // Value ctor: the residues are coded in order, upper or lower case,
+  // then the gap. Any other char is coded as unknown
+  CodeTable( const char *residues, int gapCode, int unknownCode )
+  {
+    std::fill( codes, codes + 256, unknownCode );
+    for ( int i = 0; residues[ i ]; i++ )
+    {
+      codes[ (uint8_t) residues[ i ] ] = i;
+      codes[ (uint8_t) std::tolower( residues[ i ] ) ] = i;
+    }
+    codes[ (uint8_t) '-' ] = gapCode;
+  }
+
+  // The code of each char
+  uint8_t codes[ 256 ];
+};
+
+const int DnaAlphabet::NUM_RESIDUES;
+const int DnaAlphabet::GAP_CODE;
+const int DnaAlphabet::UNKNOWN_CODE;
+const int DnaAlphabet::NUM_CODES;
+const int ProteinAlphabet::NUM_RESIDUES;
+const int ProteinAlphabet::GAP_CODE;
+const int ProteinAlphabet::UNKNOWN_CODE;
+const int ProteinAlphabet::NUM_CODES;
+
+// Create the table of the nucleotides. A 'U' is coded as a 'T'
+static CodeTable makeDnaCodes()
+{
+  CodeTable table( DNA_RESIDUES, DnaAlphabet::GAP_CODE,
+    DnaAlphabet::UNKNOWN_CODE );
+  table.codes[ (uint8_t) 'U' ] = table.codes[ (uint8_t) 'T' ];
+  table.codes[ (uint8_t) 'u' ] = table.codes[ (uint8_t) 'T' ];
+  return table;
+}
+
+// Return the table with the code of each nucleotide
+const uint8_t *DnaAlphabet::getCodes()
+{
+  static const CodeTable table = makeDnaCodes();
+  return table.codes;
+}
+
+// Return the table with the code of each amino acid
+const uint8_t *ProteinAlphabet::getCodes()
+{
+  static const CodeTable table( PROTEIN_RESIDUES, GAP_CODE, UNKNOWN_CODE );
+  return table.codes;
+}
+
+// Return the residues of the alphabet in the order of their codes
+const char *getResidues( AlgnAlphabet alphabet )
+{
+  return alphabet == ALPHABET_DNA ? DNA_RESIDUES : PROTEIN_RESIDUES;
+}
+
+// Find the alphabet from the number of times each char is used
+AlgnAlphabet findAlphabet( const std::vector< uint64_t > &charCounts )
+{
+  uint64_t numLetters     = 0;
+  uint64_t numNucleotides = 0;
+  for ( int ch = 0; ch < 256; ch++ )
+  {
+    if ( !std::isalpha( ch ) ) continue;
+    numLetters += charCounts[ ch ];
+    if ( std::strchr( NUCLEOTIDES, std::toupper( ch ) ) )
+      numNucleotides += charCounts[ ch ];
+  }
+  if ( numNucleotides >= MIN_NUCLEOTIDE_FRAC * numLetters )
+    return ALPHABET_DNA;
+  return ALPHABET_PROTEIN;
+}
+
+// Find the alphabet of an alignment
+AlgnAlphabet findAlphabet( const std::vector< const char * > &seqs,
+  size_t len
+  )
+{
+  return findAlphabet( countChars( seqs, len ) );
+}
+
+// Return the number of times each char is used in an alignment
+std::vector< uint64_t > countChars( const std::vector< const char * > &seqs,
+  size_t len
+  )
+{
+  std::vector< std::vector< uint64_t > > seqCounts( seqs.size() );
+  tbb::parallel_for( size_t( 0 ), seqs.size(), [&] ( size_t s )
+  {
+    seqCounts[ s ].assign( 256, 0 );
+    for ( size_t i = 0; i < len; i++ )
+      seqCounts[ s ][ (uint8_t) seqs[ s ][ i ] ]++;
+  });
+  std::vector< uint64_t > charCounts( 256, 0 );
+  for ( auto &counts : seqCounts )
+    for ( int ch = 0; ch < 256; ch++ ) charCounts[ ch ] += counts[ ch ];
+  return charCounts;
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,96 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Alphabet
+// Ryan D. Crawford
+// 2020/12/17
+// -----------------------------------------------------------------------------
+// These are the alphabets of the alignments: the nucleotides of the
+// reverse translated alignment and the amino acids of the protein
+// alignment. Each alphabet gives every char a small code. The residues are
+// the codes from zero, followed by the code of the gap and the code of an
+// unknown residue, which is the code of 'N' and any other char. 'N' is a
+// missing residue in both alphabets, as it has always been in the
+// distances and column statistics, so asparagine is not compared in an
+// amino acid alignment. A residue is valid if its code is less than the
+// number of residues, so the valid sites are found without comparing the
+// chars, and the counts of each column only need one count for each code.
+// The kernels that count the symbols of an alignment are
+// templates on the alphabet type. The alphabet of an alignment is found
+// from the fraction of its letters that are nucleotides, so a protein
+// alignment is not taken for nucleotides because it happens to lack the
+// letters that are only amino acids. In a nucleotide alignment the IUPAC
+// ambiguity codes, such as R and Y, are unknown residues like 'N', so the
+// positions with an ambiguous base are not compared.
+// -----------------------------------------------------------------------------
+
+#ifndef _ALPHABET_
+#define _ALPHABET_
+
+// The alphabets of an alignment
+enum AlgnAlphabet
+{
+  ALPHABET_DNA     = 0,
+  ALPHABET_PROTEIN = 1
+};
+
+// The nucleotides A, C, G and T. A 'U' is coded as a 'T'
+struct DnaAlphabet
+{
+  // Number of residues, the codes below the gap code
+  static const int NUM_RESIDUES = 4;
+
+  // Code of the gap and of 'N' and any other char
+  static const int GAP_CODE     = 4;
+  static const int UNKNOWN_CODE = 5;
+
+  // Number of codes in the alphabet
+  static const int NUM_CODES = 6;
+
+  // Return the table with the code of each char
+  static const uint8_t *getCodes();
+};
+
+// The amino acids other than 'N'
+struct ProteinAlphabet
+{
+  // Number of residues, the codes below the gap code
+  static const int NUM_RESIDUES = 19;
+
+  // Code of the gap and of 'N', 'X' and any other char
+  static const int GAP_CODE     = 19;
+  static const int UNKNOWN_CODE = 20;
+
+  // Number of codes in the alphabet
+  static const int NUM_CODES = 21;
+
+  // Return the table with the code of each char
+  static const uint8_t *getCodes();
+};
+
+// Return the residues of the alphabet in the order of their codes
+const char *getResidues( AlgnAlphabet alphabet );
+
+// Minimum fraction of the letters of a nucleotide alignment that are A, C,
+// G, T, U or N, in upper or lower case
+const double MIN_NUCLEOTIDE_FRAC = 0.9;
+
+// Find the alphabet from the number of times each char is used in an
+// alignment. The alignment is nucleotides if nearly all of its letters
+// are nucleotides, and amino acids otherwise
+AlgnAlphabet findAlphabet( const std::vector< uint64_t > &charCounts );
+
+// Find the alphabet of an alignment from pointers to the start of each
+// sequence and the length of the alignment
+AlgnAlphabet findAlphabet( const std::vector< const char * > &seqs,
+  size_t len );
+
+// Return the number of times each char is used in an alignment. The
+// sequences are read in parallel
+std::vector< uint64_t > countChars( const std::vector< const char * > &seqs,
+  size_t len );
+#endif
+
+// -----------------------------------------------------------------------------
@@ -75,6 +75,7 @@ private:
   // Allow access from genome class and msa class
   friend class Genome;
   friend class MultiSeqAlgn;
+  friend class AlgnRowReader;
 
   // The path to the fasta file corresponding to this genome sequence
   std::string faPath;
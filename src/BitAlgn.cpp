@@ -0,0 +1,208 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include "BitAlgn.h"
+
+// -----------------------------------------------------------------------------
+// BitAlgn
+// Ryan D. Crawford
+// 2020/12/11
+// -----------------------------------------------------------------------------
+
+// Encode the alignment
+void BitAlgn::encode( const std::vector< const char * > &seqs, size_t len )
+{
+  numSeqs  = seqs.size();
+  algnLen  = len;
+  numWords = ( len + 63 ) / 64;
+  alphabet = findAlphabet( seqs, len );
+  if ( alphabet == ALPHABET_DNA ) encodeCodes< DnaAlphabet >( seqs );
+  else encodeCodes< ProteinAlphabet >( seqs );
+}
+
+// Encode the alignment with the codes of the alphabet
+template< class Alphabet >
+void BitAlgn::encodeCodes( const std::vector< const char * > &seqs )
+{
+  // Find the number of bits to give each residue a distinct code
+  numPlanes = 1;
+  while ( ( 1 << numPlanes ) < Alphabet::NUM_RESIDUES ) numPlanes++;
+
+  // Set the bits of the valid mask and the code planes for each sequence.
+  // The sequences are encoded in parallel
+  const uint8_t *codes  = Alphabet::getCodes();
+  size_t         stride = getBitsPerSite();
+  planes.assign( numSeqs * numWords * stride, 0 );
+  tbb::parallel_for( size_t( 0 ), numSeqs, [&] ( size_t s )
+  {
+    const char *seq    = seqs[ s ];
+    uint64_t   *seqPos = planes.data() + s * numWords * stride;
+    for ( size_t w = 0; w < numWords; w++, seqPos += stride )
+    {
+      size_t wEnd = std::min( algnLen - w * 64, (size_t) 64 );
+      for ( size_t b = 0; b < wEnd; b++ )
+      {
+        uint8_t code = codes[ (uint8_t) seq[ w * 64 + b ] ];
+        if ( code >= Alphabet::NUM_RESIDUES ) continue;
+        uint64_t bit = (uint64_t) 1 << b;
+        seqPos[ 0 ] |= bit;
+        for ( size_t p = 0; p < numPlanes; p++ )
+          if ( code >> p & 1 ) seqPos[ p + 1 ] |= bit;
+      }
+    }
+  });
+}
+
+// Count the mismatches and the shared valid sites between two sequences
+void BitAlgn::countDiffs( size_t i, size_t j, size_t start, size_t len,
+  uint64_t &numMismatch, uint64_t &numShared
+  ) const
+{
+  uint64_t numTransitions;
+  countWords< false >(
+    i, j, start, len, numMismatch, numShared, numTransitions );
+}
+
+// Count the mismatches, the shared valid sites and the transitions between
+// two sequences
+void BitAlgn::countDiffs( size_t i, size_t j, size_t start, size_t len,
+  uint64_t &numMismatch, uint64_t &numShared, uint64_t &numTransitions
+  ) const
+{
+  countWords< true >(
+    i, j, start, len, numMismatch, numShared, numTransitions );
+}
+
+const uint64_t BitAlgn::CODON_MASKS[ 3 ] =
+  { 0x9249249249249249, 0x2492492492492492, 0x4924924924924924 };
+
+// Count the mismatches and the shared valid sites between two sequences at
+// each codon position
+void BitAlgn::countCodonDiffs( size_t i, size_t j, size_t start, size_t len,
+  uint64_t *numMismatch, uint64_t *numShared
+  ) const
+{
+  std::fill( numMismatch, numMismatch + 3, 0 );
+  std::fill( numShared, numShared + 3, 0 );
+  if ( !len ) return;
+
+  size_t   stride    = getBitsPerSite();
+  size_t   end       = start + len;
+  size_t   startWord = start / 64;
+  size_t   endWord   = ( end + 63 ) / 64;
+  uint64_t firstMask = ~(uint64_t) 0 << ( start % 64 );
+  uint64_t lastMask  = end % 64 ? ( (uint64_t) 1 << ( end % 64 ) ) - 1 :
+    ~(uint64_t) 0;
+
+  // A word starts at position w * 64, and 64 % 3 is one, so bit b of word
+  // w is at codon position ( w + b ) % 3. The masks of one codon position
+  // in three words in a row are the three different masks, so the bits of
+  // the codon position in the three words are combined into one word
+  // without overlap and counted with a single popcount
+  const uint64_t *iSeq = planes.data() + i * numWords * stride;
+  const uint64_t *jSeq = planes.data() + j * numWords * stride;
+  auto loadWord = [&] ( size_t w, uint64_t &diff, uint64_t &valid )
+  {
+    diff  = 0;
+    valid = 0;
+    if ( w < startWord || w >= endWord ) return;
+    const uint64_t *iPos = iSeq + w * stride;
+    const uint64_t *jPos = jSeq + w * stride;
+    valid = iPos[ 0 ] & jPos[ 0 ];
+    if ( w == startWord ) valid &= firstMask;
+    if ( w == endWord - 1 ) valid &= lastMask;
+    for ( size_t p = 1; p <= numPlanes; p++ ) diff |= iPos[ p ] ^ jPos[ p ];
+    diff &= valid;
+  };
+
+  const uint64_t mask0 = CODON_MASKS[ 0 ];
+  const uint64_t mask1 = CODON_MASKS[ 1 ];
+  const uint64_t mask2 = CODON_MASKS[ 2 ];
+  for ( size_t g = startWord / 3 * 3; g < endWord; g += 3 )
+  {
+    uint64_t diff0, valid0, diff1, valid1, diff2, valid2;
+    loadWord( g, diff0, valid0 );
+    loadWord( g + 1, diff1, valid1 );
+    loadWord( g + 2, diff2, valid2 );
+    numMismatch[ 0 ] += __builtin_popcountll(
+      ( diff0 & mask0 ) | ( diff1 & mask2 ) | ( diff2 & mask1 ) );
+    numMismatch[ 1 ] += __builtin_popcountll(
+      ( diff0 & mask1 ) | ( diff1 & mask0 ) | ( diff2 & mask2 ) );
+    numMismatch[ 2 ] += __builtin_popcountll(
+      ( diff0 & mask2 ) | ( diff1 & mask1 ) | ( diff2 & mask0 ) );
+    numShared[ 0 ] += __builtin_popcountll(
+      ( valid0 & mask0 ) | ( valid1 & mask2 ) | ( valid2 & mask1 ) );
+    numShared[ 1 ] += __builtin_popcountll(
+      ( valid0 & mask1 ) | ( valid1 & mask0 ) | ( valid2 & mask2 ) );
+    numShared[ 2 ] += __builtin_popcountll(
+      ( valid0 & mask2 ) | ( valid1 & mask1 ) | ( valid2 & mask0 ) );
+  }
+}
+
+// Count the differences in the window 64 positions at a time
+template< bool isTransitions >
+void BitAlgn::countWords( size_t i, size_t j, size_t start, size_t len,
+  uint64_t &numMismatch, uint64_t &numShared, uint64_t &numTransitions
+  ) const
+{
+  numMismatch    = 0;
+  numShared      = 0;
+  numTransitions = 0;
+  if ( !len ) return;
+
+  // Find the words in the window and mask the positions at either end that
+  // are outside of the window
+  size_t   stride    = getBitsPerSite();
+  size_t   end       = start + len;
+  size_t   startWord = start / 64;
+  size_t   endWord   = ( end + 63 ) / 64;
+  uint64_t firstMask = ~(uint64_t) 0 << ( start % 64 );
+  uint64_t lastMask  = end % 64 ? ( (uint64_t) 1 << ( end % 64 ) ) - 1 :
+    ~(uint64_t) 0;
+
+  const uint64_t *iPos = planes.data() + ( i * numWords + startWord ) * stride;
+  const uint64_t *jPos = planes.data() + ( j * numWords + startWord ) * stride;
+  for ( size_t w = startWord; w < endWord; w++, iPos += stride, jPos += stride )
+  {
+    uint64_t valid = iPos[ 0 ] & jPos[ 0 ];
+    if ( w == startWord ) valid &= firstMask;
+    if ( w == endWord - 1 ) valid &= lastMask;
+
+    // A position is a mismatch if any bit of the code differs
+    uint64_t diff = 0;
+    for ( size_t p = 1; p <= numPlanes; p++ ) diff |= iPos[ p ] ^ jPos[ p ];
+    diff &= valid;
+
+    numMismatch += __builtin_popcountll( diff );
+    numShared   += __builtin_popcountll( valid );
+
+    // A mismatch is a transition if both nucleotides are purines, A and G,
+    // or both are pyrimidines, C and T, which have the same first bit
+    if ( isTransitions )
+    {
+      uint64_t sameClass = ~( iPos[ 1 ] ^ jPos[ 1 ] );
+      numTransitions += __builtin_popcountll( diff & sameClass );
+    }
+  }
+}
+
+// Return the number of sequences that were encoded
+size_t BitAlgn::getNumSeqs() const
+{
+  return numSeqs;
+}
+
+// Return the number of bits stored for each position of a sequence
+size_t BitAlgn::getBitsPerSite() const
+{
+  return numPlanes + 1;
+}
+
+// Return the alphabet of the alignment
+AlgnAlphabet BitAlgn::getAlphabet() const
+{
+  return alphabet;
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+#include "Alphabet.h"
+
+// -----------------------------------------------------------------------------
+// BitAlgn
+// Ryan D. Crawford
+// 2020/12/11
+// -----------------------------------------------------------------------------
+// This class encodes an alignment as bitplanes to count the differences
+// between pairs of sequences 64 positions at a time. Each residue is given
+// its code in the alphabet of the alignment, and bit b of the code of each
+// position is stored in its own bitplane, two planes for nucleotides and
+// five for amino acids. A valid site mask marks the positions with a
+// residue, which are not a gap or an unknown residue. Two sequences have
+// the same symbol at a position when all of their code bits are equal, so
+// the mismatches in a word of 64 positions are the OR of the XOR of each
+// bitplane, masked by the valid sites of both sequences, and counted with
+// popcount. The planes of each word are stored next to each other so a
+// pair of sequences is compared in a single pass over memory.
+// The nucleotides are coded A = 0, C = 1, G = 2 and T = 3, so a mismatch
+// between two purines or two pyrimidines, a transition, is a mismatch where
+// the first bit of the code is the same, and the transitions are counted
+// in the same pass as the mismatches. The mismatches and shared sites at
+// each codon position are counted in the same pass by masking the bits of
+// every third position of each word.
+// -----------------------------------------------------------------------------
+
+#ifndef _BIT_ALGN_
+#define _BIT_ALGN_
+class BitAlgn
+{
+public:
+
+  // Default ctor: an empty alignment
+  BitAlgn(): numSeqs( 0 ), algnLen( 0 ), numWords( 0 ), numPlanes( 0 ),
+    alphabet( ALPHABET_DNA )
+  { ; }
+
+  // Encode the alignment from pointers to the start of each sequence and
+  // the length of the alignment. The alphabet is found from the chars of
+  // the alignment
+  void encode( const std::vector< const char * > &seqs, size_t len );
+
+  // Count the mismatches and the shared valid sites between two sequences
+  // in the window of the alignment starting at "start" of length "len"
+  void countDiffs( size_t i, size_t j, size_t start, size_t len,
+    uint64_t &numMismatch, uint64_t &numShared ) const;
+
+  // Count the mismatches, the shared valid sites and the transitions
+  // between two sequences in the window. The alignment must be nucleotides
+  void countDiffs( size_t i, size_t j, size_t start, size_t len,
+    uint64_t &numMismatch, uint64_t &numShared,
+    uint64_t &numTransitions ) const;
+
+  // Count the mismatches and the shared valid sites between two sequences
+  // in the window at each codon position. Alignment position p is at
+  // codon position p % 3, and the counts are written to the three entries
+  // of "numMismatch" and "numShared"
+  void countCodonDiffs( size_t i, size_t j, size_t start, size_t len,
+    uint64_t *numMismatch, uint64_t *numShared ) const;
+
+  // Return the alphabet of the alignment
+  AlgnAlphabet getAlphabet() const;
+
+  // Return the number of sequences that were encoded
+  size_t getNumSeqs() const;
+
+  // Return the number of bits stored for each position of a sequence
+  size_t getBitsPerSite() const;
+
+private:
+
+  // Number of sequences in the alignment
+  size_t numSeqs;
+
+  // Length of the alignment
+  size_t algnLen;
+
+  // Number of 64 bit words per bitplane
+  size_t numWords;
+
+  // Number of code bitplanes
+  size_t numPlanes;
+
+  // Mask of the bits b of a word with b % 3 equal to the index
+  static const uint64_t CODON_MASKS[ 3 ];
+
+  // Alphabet of the alignment
+  AlgnAlphabet alphabet;
+
+  // The valid site mask followed by the code bitplanes for each word of
+  // each sequence
+  std::vector< uint64_t > planes;
+
+  // Encode the alignment with the codes of the alphabet
+  template< class Alphabet >
+  void encodeCodes( const std::vector< const char * > &seqs );
+
+  // Count the differences in the window, with the transitions if
+  // "isTransitions" is true
+  template< bool isTransitions >
+  void countWords( size_t i, size_t j, size_t start, size_t len,
+    uint64_t &numMismatch, uint64_t &numShared,
+    uint64_t &numTransitions ) const;
+};
+#endif
+
+// -----------------------------------------------------------------------------
@@ -10,11 +10,13 @@
 // -----------------------------------------------------------------------------
 // This function reads in the path to a multiple sequence alignment, and Then
 // generates a distance matrix at each of the partions specified in the input
-// vector, which specifies the end of the partitions.  
+// vector, which specifies the end of the partitions. The matrices are
+// calculated in a single pass over the alignment and returned as a
+// numSeqs x numSeqs x partitions array.
 // -----------------------------------------------------------------------------
 
 // [[Rcpp::export]]
-std::list < Rcpp::NumericMatrix > CalcAlgnPartitionDists(
+Rcpp::NumericVector CalcAlgnPartitionDists(
   std::string msaPath,  std::string method, std::vector< int > genePartitions
   )
 {
@@ -24,8 +26,8 @@ std::list < Rcpp::NumericMatrix > CalcAlgnPartitionDists(
   // Read in the fasta file and check that this is a valid alignmnet
   multiSeqAlgn.parseMsa();
 
-  // Create a distance matrix with the raw alignment distances -- number
-  // of mutations between each pair of sequences
+  // Create a distance matrix for each partition, with the distances of the
+  // partition stored in distArray[ , , i ]
   return multiSeqAlgn.calcAlignPartitionDists( method, genePartitions );
 }
 
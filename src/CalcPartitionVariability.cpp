@@ -0,0 +1,35 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "MultiSeqAlgn.h"
+
+// -----------------------------------------------------------------------------
+// CalcPartitionVariability
+// Ryan D. Crawford
+// 2020/12/17
+// -----------------------------------------------------------------------------
+// This function reads in the path to a multiple sequence alignment and
+// returns the variability of each of the partitions specified by the end
+// positions in the input vector. The variability is the mean number of
+// mutations per position between the pairs of sequences in the partition,
+// found from the symbol counts of each column without calculating the
+// distance matrices of the partitions.
+// -----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+std::vector< double > CalcPartitionVariability(
+  std::string msaPath, std::vector< int > genePartitions
+  )
+{
+  // Create the msa class object
+  MultiSeqAlgn multiSeqAlgn( msaPath );
+
+  // Read in the fasta file and check that this is a valid alignmnet
+  multiSeqAlgn.parseMsa();
+
+  // Count the pairs of sequences that differ at each column and sum them
+  // over each partition
+  return multiSeqAlgn.calcPartitionVariability( genePartitions );
+}
+
+// -----------------------------------------------------------------------------
@@ -25,7 +25,8 @@ Rcpp::NumericMatrix CalcSubMatrixForAlgns( std::vector< std::string > msaPaths )
     multiSeqAlgn.parseMsa();
 
     // Update the object with the
-    algnSubCalc.updateSubMat( multiSeqAlgn.getSeqs() );
+    algnSubCalc.updateSubMat(
+      multiSeqAlgn.getRowPtrs(), multiSeqAlgn.getAlgnLen() );
   }
 
   // Normalize the matrix by the probability of each mutation occuring
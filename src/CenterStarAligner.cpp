@@ -0,0 +1,321 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <algorithm>
+#include <climits>
+#include "CenterStarAligner.h"
+
+// -----------------------------------------------------------------------------
+// CenterStarAligner
+// Ryan D. Crawford
+// 2020/11/30
+// -----------------------------------------------------------------------------
+
+// Definitions of the constant members
+const int CenterStarAligner::BAND_PAD;
+const int CenterStarAligner::MATCH;
+const int CenterStarAligner::MISMATCH;
+const int CenterStarAligner::GAP_OPEN;
+const int CenterStarAligner::GAP_EXTND;
+const int CenterStarAligner::KMER_LEN;
+
+// Align the input sequences. Returns false if the sequences are too
+// divergent to be aligned without mafft
+bool CenterStarAligner::align( const std::vector< std::string > &seqs,
+  std::vector< std::string > &algn
+  )
+{
+  if ( seqs.size() < 2 ) return false;
+  for ( auto &seq : seqs ) if ( seq.empty() ) return false;
+
+  int medoid = findMedoid( seqs );
+  if ( alignUngapped( seqs, medoid, algn ) ) return true;
+
+  // Align each sequence to the medoid and find the number of positions
+  // inserted before each position of the medoid
+  const std::string &center = seqs[ medoid ];
+  size_t m = center.size();
+  std::vector< std::string > ops( seqs.size() );
+  std::vector< int > maxIns( m + 1, 0 );
+
+  for ( size_t i = 0; i < seqs.size(); i++ )
+  {
+    if ( (int) i == medoid )
+    {
+      ops[ i ] = std::string( m, 'M' );
+      continue;
+    }
+    if ( !alignToCenter( center, seqs[ i ], ops[ i ] ) ) return false;
+
+    std::vector< int > numIns( m + 1, 0 );
+    size_t pos = 0;
+    for ( auto op : ops[ i ] )
+    {
+      if ( op == 'I' ) numIns[ pos ] ++;
+      else pos ++;
+    }
+    for ( size_t j = 0; j <= m; j++ )
+      if ( numIns[ j ] > maxIns[ j ] ) maxIns[ j ] = numIns[ j ];
+  }
+
+  // Merge the pairwise alignments. The insertions of each sequence are
+  // placed at the start of the columns inserted before each position of the
+  // medoid, and the remaining columns are filled with gaps
+  size_t algnLen = m;
+  for ( auto n : maxIns ) algnLen += n;
+
+  algn.assign( seqs.size(), "" );
+  for ( size_t i = 0; i < seqs.size(); i++ )
+  {
+    std::string &row = algn[ i ];
+    row.reserve( algnLen );
+
+    size_t pos    = 0; // Position in the medoid
+    size_t seqPos = 0; // Position in this sequence
+    int    numIns = 0; // Number of insertions before this medoid position
+    for ( auto op : ops[ i ] )
+    {
+      if ( op == 'I' )
+      {
+        row.push_back( seqs[ i ][ seqPos++ ] );
+        numIns ++;
+        continue;
+      }
+
+      row.append( maxIns[ pos ] - numIns, '-' );
+      row.push_back( op == 'M' ? seqs[ i ][ seqPos++ ] : '-' );
+      numIns = 0;
+      pos ++;
+    }
+    row.append( maxIns[ m ] - numIns, '-' );
+  }
+
+  return true;
+}
+
+// Find the sorted k-mers in a sequence
+std::vector< uint32_t > CenterStarAligner::getKmers( const std::string &seq )
+{
+  std::vector< uint32_t > kmers;
+  if ( seq.size() < KMER_LEN ) return kmers;
+  kmers.reserve( seq.size() - KMER_LEN + 1 );
+
+  // Each residue is packed into 5 bits of the k-mer
+  uint32_t kmer = 0;
+  uint32_t mask = ( 1u << ( 5 * KMER_LEN ) ) - 1;
+  for ( size_t i = 0; i < seq.size(); i++ )
+  {
+    kmer = ( ( kmer << 5 ) | ( seq[ i ] & 31 ) ) & mask;
+    if ( i + 1 >= KMER_LEN ) kmers.push_back( kmer );
+  }
+
+  std::sort( kmers.begin(), kmers.end() );
+  return kmers;
+}
+
+// Find the index of the medoid sequence as the sequence sharing the most
+// k-mers with the other sequences
+int CenterStarAligner::findMedoid( const std::vector< std::string > &seqs )
+{
+  std::vector< std::vector< uint32_t > > kmers;
+  kmers.reserve( seqs.size() );
+  for ( auto &seq : seqs ) kmers.push_back( getKmers( seq ) );
+
+  // The distance between two sequences is the fraction of the k-mers of the
+  // shorter sequence that are not shared
+  std::vector< double > sumDist( seqs.size(), 0 );
+  for ( size_t i = 0; i < seqs.size(); i++ )
+  {
+    for ( size_t j = i + 1; j < seqs.size(); j++ )
+    {
+      auto a = kmers[ i ].begin();
+      auto b = kmers[ j ].begin();
+      size_t numShared = 0;
+      while ( a != kmers[ i ].end() && b != kmers[ j ].end() )
+      {
+        if ( *a < *b ) a ++;
+        else if ( *b < *a ) b ++;
+        else
+        {
+          numShared ++;
+          a ++;
+          b ++;
+        }
+      }
+
+      size_t minKmers = std::min( kmers[ i ].size(), kmers[ j ].size() );
+      double dist = minKmers ? 1.0 - (double) numShared / minKmers : 1.0;
+      sumDist[ i ] += dist;
+      sumDist[ j ] += dist;
+    }
+  }
+
+  return std::min_element( sumDist.begin(), sumDist.end() ) - sumDist.begin();
+}
+
+// Align the sequences without any gaps if they are the same length and
+// nearly identical to the medoid
+bool CenterStarAligner::alignUngapped( const std::vector< std::string > &seqs,
+  int medoid, std::vector< std::string > &algn
+  )
+{
+  const std::string &center = seqs[ medoid ];
+  size_t maxDiffs = ( 1.0 - minIdent ) * center.size();
+
+  for ( auto &seq : seqs )
+  {
+    if ( seq.size() != center.size() ) return false;
+
+    size_t numDiffs = 0;
+    for ( size_t i = 0; i < seq.size(); i++ )
+      numDiffs += seq[ i ] != center[ i ];
+    if ( numDiffs > maxDiffs ) return false;
+  }
+
+  algn = seqs;
+  return true;
+}
+
+// Align a sequence to the center sequence with a banded global alignment
+bool CenterStarAligner::alignToCenter( const std::string &center,
+  const std::string &seq, std::string &ops
+  )
+{
+  // Trace back flags for each cell: the source of the best score and if the
+  // gaps in each sequence were extended
+  const uint8_t FROM_DIAG = 0;
+  const uint8_t FROM_INS  = 1;
+  const uint8_t FROM_DEL  = 2;
+  const uint8_t INS_EXTND = 4;
+  const uint8_t DEL_EXTND = 8;
+  const int     NEG       = INT_MIN / 4;
+
+  // The band covers the diagonals between the start and the end of the
+  // alignment with padding on either side
+  int m     = center.size();
+  int n     = seq.size();
+  int bLow  = std::min( 0, n - m ) - BAND_PAD;
+  int bHigh = std::max( 0, n - m ) + BAND_PAD;
+  int width = bHigh - bLow + 1;
+
+  // Scores of the previous and current row of the band. The best score
+  // ending in an insertion, 'I', is only needed for the current row.
+  std::vector< int > prevH( width, NEG ), prevD( width, NEG );
+  std::vector< int > curH( width, NEG ), curD( width, NEG ), curI( width );
+  std::vector< uint8_t > trace( (size_t) ( m + 1 ) * width, 0 );
+
+  // The first row of the alignment is a gap in the center sequence
+  for ( int j = 0; j <= std::min( n, bHigh ); j++ )
+  {
+    int k = j - bLow;
+    prevH[ k ] = j ? GAP_OPEN + ( j - 1 ) * GAP_EXTND : 0;
+    if ( j ) trace[ k ] = FROM_INS | ( j > 1 ? INS_EXTND : 0 );
+  }
+
+  for ( int i = 1; i <= m; i++ )
+  {
+    std::fill( curH.begin(), curH.end(), NEG );
+    std::fill( curD.begin(), curD.end(), NEG );
+    std::fill( curI.begin(), curI.end(), NEG );
+
+    int jStart = std::max( 0, i + bLow );
+    int jEnd   = std::min( n, i + bHigh );
+    uint8_t *rowTrace = &trace[ (size_t) i * width ];
+
+    for ( int j = jStart; j <= jEnd; j++ )
+    {
+      int k = j - i - bLow;
+      uint8_t tb = 0;
+
+      // Insertion: the sequence has a residue that is not in the center
+      int insScore = NEG;
+      if ( j > 0 && k > 0 )
+      {
+        int openScore = curH[ k - 1 ] + GAP_OPEN;
+        int extScore  = curI[ k - 1 ] + GAP_EXTND;
+        insScore = std::max( openScore, extScore );
+        if ( extScore > openScore ) tb |= INS_EXTND;
+      }
+      curI[ k ] = insScore;
+
+      // Deletion: the center has a residue that is not in the sequence
+      int delScore = NEG;
+      if ( k + 1 < width )
+      {
+        int openScore = prevH[ k + 1 ] + GAP_OPEN;
+        int extScore  = prevD[ k + 1 ] + GAP_EXTND;
+        delScore = std::max( openScore, extScore );
+        if ( extScore > openScore ) tb |= DEL_EXTND;
+      }
+      curD[ k ] = delScore;
+
+      // Match or mismatch
+      int diagScore = NEG;
+      if ( j > 0 )
+        diagScore = prevH[ k ] +
+          ( center[ i - 1 ] == seq[ j - 1 ] ? MATCH : MISMATCH );
+
+      int best = diagScore;
+      uint8_t from = FROM_DIAG;
+      if ( insScore > best )
+      {
+        best = insScore;
+        from = FROM_INS;
+      }
+      if ( delScore > best )
+      {
+        best = delScore;
+        from = FROM_DEL;
+      }
+      curH[ k ] = best;
+      rowTrace[ k ] = tb | from;
+    }
+
+    std::swap( prevH, curH );
+    std::swap( prevD, curD );
+  }
+
+  // Trace back from the end of both sequences
+  ops.clear();
+  int i = m;
+  int j = n;
+  int numMatch   = 0;
+  int numAligned = 0;
+  uint8_t state  = FROM_DIAG;
+  while ( i > 0 || j > 0 )
+  {
+    int k = j - i - bLow;
+
+    // If the path reaches the edge of the band, the band may not contain
+    // the best alignment
+    if ( k <= 0 || k >= width - 1 ) return false;
+
+    uint8_t tb = trace[ (size_t) i * width + k ];
+    if ( state == FROM_DIAG )
+    {
+      state = tb & 3;
+      if ( state != FROM_DIAG ) continue;
+      numAligned ++;
+      numMatch += center[ i - 1 ] == seq[ j - 1 ];
+      ops.push_back( 'M' );
+      i --;
+      j --;
+    }
+    else if ( state == FROM_INS )
+    {
+      ops.push_back( 'I' );
+      state = tb & INS_EXTND ? FROM_INS : FROM_DIAG;
+      j --;
+    }
+    else
+    {
+      ops.push_back( 'D' );
+      state = tb & DEL_EXTND ? FROM_DEL : FROM_DIAG;
+      i --;
+    }
+  }
+  std::reverse( ops.begin(), ops.end() );
+
+  return numAligned && numMatch >= minIdent * numAligned;
+}
+
+// -----------------------------------------------------------------------------
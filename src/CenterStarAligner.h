@@ -0,0 +1,77 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// CenterStarAligner
+// Ryan D. Crawford
+// 2020/11/30
+// -----------------------------------------------------------------------------
+// This class aligns clusters of highly similar genes without mafft. The
+// medoid of the cluster is selected from the shared k-mers of each pair of
+// genes. If all of the genes are the same length and are nearly identical to
+// the medoid, the genes are used as the alignment without any gaps.
+// Otherwise each gene is aligned to the medoid with a banded global
+// alignment using affine gap penalties, and the pairwise alignments are
+// merged into a multiple sequence alignment with the center-star method. If
+// any gene is more divergent than the identity threshold or needs more
+// indels than the band allows, the cluster is left for mafft.
+// -----------------------------------------------------------------------------
+
+#ifndef _CENTER_STAR_ALIGNER_
+#define _CENTER_STAR_ALIGNER_
+class CenterStarAligner
+{
+public:
+
+  // Value ctor: takes the minimum identity of each gene to the medoid
+  CenterStarAligner( double minIdent = 0.98 ): minIdent( minIdent )
+  { ; }
+
+  // Align the input sequences. Returns false if the sequences are too
+  // divergent to be aligned without mafft, otherwise the alignment is
+  // stored in "algn" in the same order as the input
+  bool align( const std::vector< std::string > &seqs,
+    std::vector< std::string > &algn );
+
+private:
+
+  // Minimum identity of each gene to the medoid
+  double minIdent;
+
+  // Number of diagonals added to each side of the band beyond the
+  // difference in the length of the sequences
+  static const int BAND_PAD = 8;
+
+  // Scores used in the pairwise alignment
+  static const int MATCH     = 2;
+  static const int MISMATCH  = -1;
+  static const int GAP_OPEN  = -5;
+  static const int GAP_EXTND = -1;
+
+  // Length of the k-mers used to select the medoid
+  static const int KMER_LEN = 3;
+
+  // Find the sorted k-mers in a sequence
+  std::vector< uint32_t > getKmers( const std::string &seq );
+
+  // Find the index of the medoid sequence as the sequence sharing the most
+  // k-mers with the other sequences
+  int findMedoid( const std::vector< std::string > &seqs );
+
+  // Align the sequences without any gaps if they are the same length and
+  // nearly identical to the medoid
+  bool alignUngapped( const std::vector< std::string > &seqs, int medoid,
+    std::vector< std::string > &algn );
+
+  // Align a sequence to the center sequence with a banded global alignment.
+  // The alignment is returned as a string of operations: 'M' for aligned
+  // positions, 'I' for positions only in the sequence and 'D' for positions
+  // only in the center. Returns false if the alignment leaves the band or
+  // the identity is below the threshold
+  bool alignToCenter( const std::string &center, const std::string &seq,
+    std::string &ops );
+};
+#endif
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,81 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <fstream>
+#include <cstring>
+#include "ConcatAlgnBuilder.h"
+
+// -----------------------------------------------------------------------------
+// ConcatAlgnBuilder
+// Ryan D. Crawford
+// 2020/12/07
+// -----------------------------------------------------------------------------
+
+// Build the concatenated alignment from the alignment of each gene
+void ConcatAlgnBuilder::build( const std::vector< GeneAlgn > &geneAlgns )
+{
+  // Find the start of each gene in the concatenated alignment
+  std::vector< size_t > geneStarts( geneAlgns.size(), 0 );
+  isIncluded.assign( geneAlgns.size(), false );
+  genePositions.clear();
+  algnLen = 0;
+  for ( size_t i = 0; i < geneAlgns.size(); i++ )
+  {
+    if ( !geneAlgns[ i ].getAlgnLen() ) continue;
+    isIncluded[ i ] = true;
+    geneStarts[ i ] = algnLen;
+    algnLen += geneAlgns[ i ].getAlgnLen();
+    genePositions.push_back( algnLen );
+  }
+
+  // Allocate the whole alignment and copy each gene into its columns. The
+  // genes write to disjoint columns, so they are copied in parallel.
+  size_t nRows = genomeNames.size();
+  algn.assign( nRows * algnLen, '-' );
+  tbb::parallel_for( size_t( 0 ), geneAlgns.size(), [&] ( size_t i )
+  {
+    if ( !isIncluded[ i ] ) return;
+
+    const GeneAlgn &geneAlgn = geneAlgns[ i ];
+    const std::vector< int > &rowIdxs = geneAlgn.getRowIdxs();
+    size_t geneLen = geneAlgn.getAlgnLen();
+    for ( size_t j = 0; j < nRows; j++ )
+    {
+      if ( rowIdxs[ j ] < 0 ) continue;
+      std::memcpy( &algn[ j * algnLen + geneStarts[ i ] ],
+        geneAlgn.getRow( rowIdxs[ j ] ), geneLen );
+    }
+  });
+}
+
+// Return the 1-based end position of each gene in the alignment
+const std::vector< int > &ConcatAlgnBuilder::getGenePositions() const
+{
+  return genePositions;
+}
+
+// Return true for each gene that was included in the alignment
+const std::vector< bool > &ConcatAlgnBuilder::getIsIncluded() const
+{
+  return isIncluded;
+}
+
+// Write the concatenated alignment to a fasta file
+bool ConcatAlgnBuilder::writeFasta( const std::string &faPath ) const
+{
+  std::ofstream ofs( faPath.c_str(), std::ios::binary );
+  if ( ofs.fail() ) return false;
+
+  for ( size_t i = 0; i < genomeNames.size(); i++ )
+  {
+    ofs << '>' << genomeNames[ i ] << '\n';
+    ofs.write( algn.data() + i * algnLen, algnLen );
+    ofs << '\n';
+  }
+  ofs.close();
+
+  return !ofs.fail();
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "GeneAlgn.h"
+
+// -----------------------------------------------------------------------------
+// ConcatAlgnBuilder
+// Ryan D. Crawford
+// 2020/12/07
+// -----------------------------------------------------------------------------
+// This class builds the concatenated gene alignment from the genome ordered
+// alignment of each gene. Once the length of every gene alignment is known,
+// the partition of each gene is computed and a single row-major buffer is
+// allocated for the whole alignment. The genes are then copied into their
+// columns of the buffer in parallel, with gaps for genomes missing the gene,
+// and the alignment is written to a fasta file in a single pass. Genes
+// without any aligned rows are not included.
+// -----------------------------------------------------------------------------
+
+#ifndef _CONCAT_ALGN_BUILDER_
+#define _CONCAT_ALGN_BUILDER_
+class ConcatAlgnBuilder
+{
+public:
+
+  // Value ctor: takes the names of the genomes in the order of the rows
+  ConcatAlgnBuilder( const std::vector< std::string > &genomeNames ):
+    genomeNames( genomeNames ), algnLen( 0 )
+  { ; }
+
+  // Build the concatenated alignment from the alignment of each gene
+  void build( const std::vector< GeneAlgn > &geneAlgns );
+
+  // Return the 1-based end position of each gene in the alignment
+  const std::vector< int > &getGenePositions() const;
+
+  // Return true for each gene that was included in the alignment
+  const std::vector< bool > &getIsIncluded() const;
+
+  // Write the concatenated alignment to a fasta file. Returns true if the
+  // file was written
+  bool writeFasta( const std::string &faPath ) const;
+
+private:
+
+  // Names of the genomes in the order of the rows
+  std::vector< std::string > genomeNames;
+
+  // Total length of the alignment
+  size_t algnLen;
+
+  // Row-major buffer with the concatenated alignment
+  std::vector< char > algn;
+
+  // End position of each gene included in the alignment
+  std::vector< int > genePositions;
+
+  // Bool indicating that each gene was included in the alignment
+  std::vector< bool > isIncluded;
+};
+#endif
+
+// -----------------------------------------------------------------------------
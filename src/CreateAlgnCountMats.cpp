@@ -0,0 +1,49 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "MultiSeqAlgn.h"
+
+// -----------------------------------------------------------------------------
+//  CreateAlgnCountMats
+//  Ryan D. Crawford
+//  2020/12/17
+//  ----------------------------------------------------------------------------
+//' @name CreateAlgnCountMats
+//' @title Create Algnment Count Matrices
+//' @description
+//'   This function reads in the path to a multiple sequence alignment and
+//'   counts the mismatches and the shared sites, the positions where
+//'   neither sequence has a gap or an unknown residue, between each pair of
+//'   sequences. Every matrix is filled from the same pass over the
+//'   alignment, so the cost is close to that of a single "raw" distance
+//'   matrix. The counts at each codon position of a nucleotide alignment
+//'   can also be returned.
+//' @param msaPath Path to the alignment in fasta or binary format
+//' @param byCodon Logical to also count the mismatches and shared sites at
+//'   each codon position. Alignment positions 1, 4, 7, ... are codon
+//'   position 1, positions 2, 5, 8, ... are codon position 2 and so on.
+//'   Only for nucleotide alignments. Defaults to false.
+//' @return A numeric array of numSeqs x numSeqs x matrices. The matrices
+//'   are named "mismatches" and "sites", followed by "mismatches1",
+//'   "sites1", "mismatches2", "sites2", "mismatches3" and "sites3" if
+//'   byCodon is true.
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+Rcpp::NumericVector CreateAlgnCountMats( std::string msaPath,
+  bool byCodon=false
+  )
+{
+  // Create the msa class object
+  MultiSeqAlgn multiSeqAlgn( msaPath );
+
+  // Read in the fasta file and check that this is a valid alignmnet
+  multiSeqAlgn.parseMsa();
+
+  // Count the mismatches and the shared sites of every pair, with the
+  // counts of matrix "name" stored in countArray[ , , name ]
+  return multiSeqAlgn.createCountMats( byCodon );
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,49 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "MultiSeqAlgn.h"
+#include "DistOutput.h"
+
+// -----------------------------------------------------------------------------
+//  CreateAlgnDist
+//  Ryan D. Crawford
+//  2020/12/14
+//  ----------------------------------------------------------------------------
+//' @name CreateAlgnDist
+//' @title Create Algnment Distance Object
+//' @description
+//'   This function reads in the path to a multiple sequence alignment and
+//'   returns the pairwise distances between the sequences as an R "dist"
+//'   object. Only the lower triangle of the distance matrix is stored, so
+//'   the object uses half of the memory of the matrix returned by
+//'   CreateAlgnDistMat, and a quarter when the "raw" distances are stored
+//'   as integers. The pairwise distances are calculated in parallel via the
+//'   RcppParallel package.
+//' @param msaPath Path to the alignment in fasta or binary format
+//' @param method Method for calculating distance: "raw", "shared",
+//'   "pDist", "JC69", "K2P", "poisson", "normProb" or "logLike". "pDist"
+//'   is the same as "shared".
+//' @param storage Type used to store the distances: "double" or "integer".
+//'   Only the "raw" distances can be stored as integers. Defaults to
+//'   "double".
+//' @return A dist object
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+Rcpp::RObject CreateAlgnDist( std::string msaPath, std::string method,
+  std::string storage="double"
+  )
+{
+  DistStorage distStorage = DistOutput::parseStorage( storage );
+
+  // Create the msa class object
+  MultiSeqAlgn multiSeqAlgn( msaPath );
+
+  // Read in the alignment and check that this is a valid alignmnet
+  multiSeqAlgn.parseMsa();
+
+  return multiSeqAlgn.createDist( method, distStorage );
+}
+
+// -----------------------------------------------------------------------------
@@ -15,16 +15,23 @@
 //'   pairwise alignment distances for each sequence are returned. The
 //'   pairwise distances are calculated in parallel via the RcppParallel
 //'   package.
-//' @param msaPath Path to the alignment
-//' @param method Method for calculating distance: "raw", or "shared."
+//' @param msaPath Path to the alignment in fasta or binary format
+//' @param method Method for calculating distance: "raw", "shared",
+//'   "pDist", "JC69", "K2P", "poisson", "normProb" or "logLike".
 //' @param isCore Logical to specify whether to remove gap positions from the
 //'   alignment to create the core genome.
+//' @param sparse Logical to count the distances from the differences of
+//'   each sequence from the consensus of the alignment. Much faster when
+//'   the sequences have few differences relative to the alignment length.
+//'   Not for the "K2P", "normProb" or "logLike" methods. Defaults to false.
 //' @return A numeric matrix
 //' @export
 //  ----------------------------------------------------------------------------
 
 // [[Rcpp::export]]
-Rcpp::NumericMatrix CreateAlgnDistMat( std::string msaPath, std::string method )
+Rcpp::NumericMatrix CreateAlgnDistMat( std::string msaPath, std::string method,
+  bool sparse=false
+  )
 {
   // Create the msa class object
   MultiSeqAlgn multiSeqAlgn( msaPath );
@@ -34,7 +41,7 @@ Rcpp::NumericMatrix CreateAlgnDistMat( std::string msaPath, std::string method )
 
   // Create a distance matrix with the raw alignment distances -- number
   // of mutations between each pair of sequences
-  return multiSeqAlgn.createDistMat( method );
+  return multiSeqAlgn.createDistMat( method, sparse );
 }
 
 // -----------------------------------------------------------------------------
@@ -8,11 +8,16 @@
 // Ryan D. Crawford
 // 05/15/2020
 // -----------------------------------------------------------------------------
-// This function reads in the path to a multiple sequence alignment.
+// This function reads in the path to a multiple sequence alignment. If
+// "sparse" is true, the distances are counted from the differences of each
+// sequence from the consensus, which is much faster for outbreak datasets
+// with few SNPs per genome.
 // -----------------------------------------------------------------------------
 
 // [[Rcpp::export]]
-Rcpp::NumericMatrix CreateCoreGenomeDistMat( std::string msaPath )
+Rcpp::NumericMatrix CreateCoreGenomeDistMat( std::string msaPath,
+  bool sparse=false
+  )
 {
   // Create the msa class object
   MultiSeqAlgn multiSeqAlgn( msaPath );
@@ -25,7 +30,7 @@ Rcpp::NumericMatrix CreateCoreGenomeDistMat( std::string msaPath )
 
   // Create a distance matrix with the raw alignment distances -- number
   // of mutations between each pair of sequences
-  return multiSeqAlgn.createDistMat( "shared" );
+  return multiSeqAlgn.createDistMat( "shared", sparse );
 }
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,419 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include "DistFile.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// DistFile
+// Ryan D. Crawford
+// 2020/12/14
+// -----------------------------------------------------------------------------
+
+// Identifies the file as a binary distance matrix
+static const char DIST_FILE_MAGIC[ 8 ] =
+  { 'C', 'G', 'N', 'D', 'I', 'S', 'T', 0 };
+
+// Version of the file format written by this class
+static const uint32_t DIST_FILE_VERSION = 2;
+
+// Written as is so a file with the opposite byte order is detected
+static const uint32_t DIST_FILE_BYTE_ORDER = 0x01020304;
+
+// Each section starts on a multiple of this size
+static const uint64_t DIST_FILE_ALIGN = 64;
+
+// Round an offset up to the start of the next section
+static uint64_t alignOffset( uint64_t offset )
+{
+  return ( offset + DIST_FILE_ALIGN - 1 ) / DIST_FILE_ALIGN * DIST_FILE_ALIGN;
+}
+
+DistFile::DistFile():
+  data( nullptr ), dataSize( 0 ), header( nullptr ), isWritable( false )
+{ ; }
+
+DistFile::~DistFile()
+{
+  close();
+}
+
+// Create a distance file and map it for writing
+bool DistFile::create( const std::string &path,
+  const std::vector< std::string > &seqNames, DistStorage storage,
+  size_t blockSize
+  )
+{
+  close();
+
+  // Lay out the sections of the file
+  DistFileHeader newHeader;
+  std::memset( &newHeader, 0, sizeof( newHeader ) );
+  std::memcpy( newHeader.magic, DIST_FILE_MAGIC, sizeof( newHeader.magic ) );
+  newHeader.version     = DIST_FILE_VERSION;
+  newHeader.byteOrder   = DIST_FILE_BYTE_ORDER;
+  newHeader.numSeqs     = seqNames.size();
+  newHeader.storage     = storage;
+  newHeader.namesOffset = alignOffset( sizeof( newHeader ) );
+  for ( auto &seqName : seqNames ) newHeader.namesSize += seqName.size() + 1;
+  newHeader.dataOffset  =
+    alignOffset( newHeader.namesOffset + newHeader.namesSize );
+  if ( blockSize )
+  {
+    size_t numBlocks      = ( seqNames.size() + blockSize - 1 ) / blockSize;
+    newHeader.blockSize   = blockSize;
+    newHeader.numTiles    = numBlocks * ( numBlocks + 1 ) / 2;
+    newHeader.tilesOffset = newHeader.dataOffset;
+    newHeader.dataOffset  =
+      alignOffset( newHeader.tilesOffset + newHeader.numTiles );
+  }
+  size_t fileSize = newHeader.dataOffset +
+    DistOutput::getCondensedSize( seqNames.size() ) *
+    DistOutput::getStorageBytes( storage );
+
+#ifndef _WIN32
+  // Size the file before mapping it. The distances are zero until they
+  // are written
+  int fd = ::open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+  if ( fd < 0 ) return false;
+  if ( ftruncate( fd, fileSize ) != 0 )
+  {
+    ::close( fd );
+    return false;
+  }
+  void *addr = mmap(
+    nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  ::close( fd );
+  if ( addr == MAP_FAILED ) return false;
+  data = static_cast< char * >( addr );
+#else
+  fileBuf.assign( fileSize, 0 );
+  data = fileBuf.data();
+#endif
+  dataSize   = fileSize;
+  isWritable = true;
+  filePath   = path;
+
+  // Write the header and the names
+  std::memcpy( data, &newHeader, sizeof( newHeader ) );
+  char *name = data + newHeader.namesOffset;
+  for ( auto &seqName : seqNames )
+  {
+    std::memcpy( name, seqName.c_str(), seqName.size() + 1 );
+    name += seqName.size() + 1;
+  }
+  header = reinterpret_cast< const DistFileHeader * >( data );
+
+#ifdef _WIN32
+  // Write the whole file once, so the tiles can be written in place
+  std::ofstream ofs( path.c_str(), std::ios::binary | std::ios::trunc );
+  ofs.write( fileBuf.data(), fileBuf.size() );
+  ofs.close();
+  if ( ofs.fail() )
+  {
+    isWritable = false;
+    close();
+    return false;
+  }
+#endif
+
+  return true;
+}
+
+// Open and map a distance file for reading or for writing
+bool DistFile::open( const std::string &path, bool isUpdate )
+{
+  close();
+
+#ifndef _WIN32
+  int fd = ::open( path.c_str(), isUpdate ? O_RDWR : O_RDONLY );
+  if ( fd < 0 ) return false;
+
+  struct stat fileStat;
+  if ( fstat( fd, &fileStat ) != 0 ||
+       fileStat.st_size < (off_t) sizeof( DistFileHeader ) )
+  {
+    ::close( fd );
+    return false;
+  }
+
+  // The mapping stays valid after the file descriptor is closed
+  dataSize = fileStat.st_size;
+  int   prot = isUpdate ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *addr = mmap( nullptr, dataSize, prot, MAP_SHARED, fd, 0 );
+  ::close( fd );
+  if ( addr == MAP_FAILED )
+  {
+    dataSize = 0;
+    return false;
+  }
+  data = static_cast< char * >( addr );
+#else
+  std::ifstream ifs( path.c_str(), std::ios::binary | std::ios::ate );
+  if ( ifs.fail() ) return false;
+  fileBuf.resize( ifs.tellg() );
+  ifs.seekg( 0 );
+  if ( fileBuf.size() < sizeof( DistFileHeader ) ||
+       !ifs.read( fileBuf.data(), fileBuf.size() ) )
+  {
+    std::vector< char >().swap( fileBuf );
+    return false;
+  }
+  data     = fileBuf.data();
+  dataSize = fileBuf.size();
+#endif
+  isWritable = isUpdate;
+  filePath   = path;
+
+  header = reinterpret_cast< const DistFileHeader * >( data );
+  if ( !isValidHeader() )
+  {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+// Write any pending changes and unmap the file
+bool DistFile::close()
+{
+  bool isWritten = true;
+  if ( data && isWritable )
+    isWritten = syncRanges( { std::make_pair( size_t( 0 ), dataSize ) } );
+#ifndef _WIN32
+  if ( data ) munmap( data, dataSize );
+#else
+  std::vector< char >().swap( fileBuf );
+#endif
+  data       = nullptr;
+  dataSize   = 0;
+  header     = nullptr;
+  isWritable = false;
+  return isWritten;
+}
+
+// Check that the sections in the header are inside of the file
+bool DistFile::isValidHeader() const
+{
+  if ( std::memcmp( header->magic, DIST_FILE_MAGIC, sizeof( header->magic ) ) ||
+       header->version != DIST_FILE_VERSION ||
+       header->byteOrder != DIST_FILE_BYTE_ORDER ||
+       header->storage > DIST_UINT32 )
+    return false;
+
+  // Check that there is a flag for every tile
+  if ( header->blockSize )
+  {
+    uint64_t numBlocks = header->numSeqs / header->blockSize +
+      ( header->numSeqs % header->blockSize != 0 );
+    if ( numBlocks > dataSize ||
+         header->numTiles != numBlocks * ( numBlocks + 1 ) / 2 ||
+         header->tilesOffset > dataSize ||
+         header->numTiles > dataSize - header->tilesOffset )
+      return false;
+  }
+  else if ( header->numTiles )
+  {
+    return false;
+  }
+
+  // Check the size of the triangle without overflowing
+  size_t valBytes = DistOutput::getStorageBytes(
+    static_cast< DistStorage >( header->storage ) );
+  if ( header->numSeqs > dataSize ) return false;
+  uint64_t triSize = DistOutput::getCondensedSize( header->numSeqs );
+  if ( triSize > dataSize / valBytes ) return false;
+
+  if ( header->namesOffset > dataSize ||
+       header->namesSize > dataSize - header->namesOffset ||
+       header->dataOffset > dataSize ||
+       triSize * valBytes > dataSize - header->dataOffset )
+    return false;
+
+  // Check that there is a null terminated name for every sequence
+  const char *names = data + header->namesOffset;
+  if ( header->namesSize && names[ header->namesSize - 1 ] != '\0' )
+    return false;
+  uint64_t numNames = std::count( names, names + header->namesSize, '\0' );
+  if ( numNames != header->numSeqs ) return false;
+
+  return true;
+}
+
+// Return the number of sequences in the matrix
+size_t DistFile::getNumSeqs() const
+{
+  return header ? header->numSeqs : 0;
+}
+
+// Return the type used to store the distances
+DistStorage DistFile::getStorage() const
+{
+  return header ? static_cast< DistStorage >( header->storage ) : DIST_DOUBLE;
+}
+
+// Return the names of the sequences
+std::vector< std::string > DistFile::getSeqNames() const
+{
+  std::vector< std::string > seqNames;
+  if ( !header ) return seqNames;
+
+  seqNames.reserve( header->numSeqs );
+  const char *name     = data + header->namesOffset;
+  const char *namesEnd = name + header->namesSize;
+  while ( name < namesEnd )
+  {
+    seqNames.push_back( name );
+    name += seqNames.back().size() + 1;
+  }
+  return seqNames;
+}
+
+// Return the number of sequences in a block of a tile
+size_t DistFile::getBlockSize() const
+{
+  return header ? header->blockSize : 0;
+}
+
+// Return the number of tiles in the lower triangle
+size_t DistFile::getNumTiles() const
+{
+  return header ? header->numTiles : 0;
+}
+
+// Return true if the distances of the tile are done
+bool DistFile::isTileDone( size_t tile ) const
+{
+  return header && tile < header->numTiles &&
+    data[ header->tilesOffset + tile ];
+}
+
+// Return true if every tile is done
+bool DistFile::isComplete() const
+{
+  if ( !header ) return false;
+  const char *tiles = data + header->tilesOffset;
+  return std::find( tiles, tiles + header->numTiles, 0 ) ==
+    tiles + header->numTiles;
+}
+
+// Write the distances to disk and then mark the tile as done
+bool DistFile::setTileDone( size_t tile )
+{
+  if ( !isWritable || tile >= getNumTiles() ) return false;
+
+  // The flag is only set once the distances are on disk, so a tile that
+  // was interrupted is never marked as done
+  if ( !syncRanges( getTileRanges( tile ) ) ) return false;
+  data[ header->tilesOffset + tile ] = 1;
+  return syncRanges( { std::make_pair( header->tilesOffset + tile, 1 ) } );
+}
+
+// Return the ranges of bytes of the distances in the tile
+std::vector< std::pair< size_t, size_t > > DistFile::getTileRanges(
+  size_t tile ) const
+{
+  // The tiles are numbered by the row block and then the column block
+  size_t iBlock = 0;
+  while ( ( iBlock + 1 ) * ( iBlock + 2 ) / 2 <= tile ) iBlock++;
+  size_t jBlock = tile - iBlock * ( iBlock + 1 ) / 2;
+
+  size_t numSeqs  = header->numSeqs;
+  size_t iStart   = iBlock * header->blockSize;
+  size_t iEnd     = std::min( iStart + header->blockSize, numSeqs );
+  size_t jStart   = jBlock * header->blockSize;
+  size_t jEnd     = std::min( jStart + header->blockSize, numSeqs );
+  size_t valBytes = DistOutput::getStorageBytes( getStorage() );
+
+  // The rows of a column of the condensed triangle are contiguous
+  std::vector< std::pair< size_t, size_t > > ranges;
+  for ( size_t j = jStart; j < jEnd; j++ )
+  {
+    size_t firstRow = std::max( iStart, j + 1 );
+    if ( firstRow >= iEnd ) continue;
+    size_t idx = DistOutput::getCondensedIdx( numSeqs, firstRow, j );
+    ranges.push_back( std::make_pair( header->dataOffset + idx * valBytes,
+      ( iEnd - firstRow ) * valBytes ) );
+  }
+  return ranges;
+}
+
+// Write the changes to the file in the ranges of bytes to disk
+bool DistFile::syncRanges(
+  const std::vector< std::pair< size_t, size_t > > &ranges )
+{
+#ifndef _WIN32
+  // msync must start on a page boundary
+  size_t pageSize = sysconf( _SC_PAGESIZE );
+  for ( auto &range : ranges )
+  {
+    size_t pageStart = range.first / pageSize * pageSize;
+    size_t len       = range.second + range.first - pageStart;
+    if ( msync( data + pageStart, len, MS_SYNC ) != 0 ) return false;
+  }
+  return true;
+#else
+  // Without mmap, write each range in place in the file
+  std::fstream fs( filePath.c_str(),
+    std::ios::binary | std::ios::in | std::ios::out );
+  for ( auto &range : ranges )
+  {
+    fs.seekp( range.first );
+    fs.write( fileBuf.data() + range.first, range.second );
+  }
+  fs.close();
+  return !fs.fail();
+#endif
+}
+
+// Return a pointer to the start of the condensed lower triangle
+const void *DistFile::getData() const
+{
+  return header ? data + header->dataOffset : nullptr;
+}
+
+// Copy the distances in the condensed lower triangle to a buffer of doubles
+void DistFile::copyDists( double *outDists ) const
+{
+  if ( !header ) return;
+
+  const char *tri     = data + header->dataOffset;
+  size_t      triSize = DistOutput::getCondensedSize( header->numSeqs );
+  switch ( getStorage() )
+  {
+    case DIST_DOUBLE:
+      std::copy( reinterpret_cast< const double * >( tri ),
+        reinterpret_cast< const double * >( tri ) + triSize, outDists );
+      break;
+    case DIST_INT:
+      std::copy( reinterpret_cast< const int32_t * >( tri ),
+        reinterpret_cast< const int32_t * >( tri ) + triSize, outDists );
+      break;
+    case DIST_FLOAT:
+      std::copy( reinterpret_cast< const float * >( tri ),
+        reinterpret_cast< const float * >( tri ) + triSize, outDists );
+      break;
+    case DIST_UINT32:
+      std::copy( reinterpret_cast< const uint32_t * >( tri ),
+        reinterpret_cast< const uint32_t * >( tri ) + triSize, outDists );
+      break;
+  }
+}
+
+// Return an output that writes to the condensed lower triangle of the file
+DistOutput DistFile::getOutput()
+{
+  if ( !isWritable ) Rcpp::stop( "The distance file is not open for writing" );
+  return DistOutput( data + header->dataOffset, header->numSeqs,
+    static_cast< DistStorage >( header->storage ) );
+}
+
+// -----------------------------------------------------------------------------
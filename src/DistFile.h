@@ -0,0 +1,169 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+#include <utility>
+#include "DistOutput.h"
+
+// -----------------------------------------------------------------------------
+// DistFile
+// Ryan D. Crawford
+// 2020/12/14
+// -----------------------------------------------------------------------------
+// This class reads and writes the binary distance matrix format. The file
+// starts with a fixed size header, followed by the names of the sequences
+// and the condensed lower triangle of the distance matrix in the order used
+// by R "dist" objects. Each section starts on a 64 byte boundary. A new file
+// is created at its full size and mapped with mmap, so the distances are
+// written directly to the file without holding the matrix in memory. A file
+// that is written one tile of blocks of sequences at a time also stores a
+// flag for each tile that is set once the distances of the tile are
+// written to disk, so an interrupted calculation is resumed from the tiles
+// that are not done. Only the bytes of a tile are written to disk when the
+// tile is done. On Windows the file is held in memory, and the bytes of a
+// tile are written to the file with a seek and write.
+// -----------------------------------------------------------------------------
+
+#ifndef _DIST_FILE_
+#define _DIST_FILE_
+
+// The header at the start of the binary distance matrix. All offsets are in
+// bytes from the start of the file
+struct DistFileHeader
+{
+  // Identifies the file as a binary distance matrix
+  char magic[ 8 ];
+
+  // Version of the file format
+  uint32_t version;
+
+  // Used to check that the file was written with the same byte order
+  uint32_t byteOrder;
+
+  // Number of sequences in the matrix
+  uint64_t numSeqs;
+
+  // Type used to store the distances
+  uint32_t storage;
+
+  // Unused, keeps the offsets aligned
+  uint32_t reserved;
+
+  // Offset and size of the null terminated sequence names
+  uint64_t namesOffset;
+  uint64_t namesSize;
+
+  // Offset of the condensed lower triangle
+  uint64_t dataOffset;
+
+  // Number of sequences in a block of a tile. Zero if the file is not
+  // written by tiles
+  uint64_t blockSize;
+
+  // Number of tiles in the lower triangle and the offset of the byte flags
+  // marking the tiles that are done
+  uint64_t numTiles;
+  uint64_t tilesOffset;
+};
+
+class DistFile
+{
+public:
+
+  // Default ctor: no file is open
+  DistFile();
+
+  // Dtor: closes the file
+  ~DistFile();
+
+  // The mapped file cannot be shared between objects
+  DistFile( const DistFile & ) = delete;
+  DistFile &operator=( const DistFile & ) = delete;
+
+  // Create a distance file for the sequences with the input names and map
+  // it for writing. The distances are initialized to zero. If "blockSize"
+  // is not zero, the file has a flag for each tile of blocks of sequences.
+  // Returns false if the file could not be created
+  bool create( const std::string &path,
+    const std::vector< std::string > &seqNames, DistStorage storage,
+    size_t blockSize = 0 );
+
+  // Open and map a distance file for reading, or for writing the tiles
+  // that are not done if "isUpdate" is true. Returns false if the file
+  // could not be opened or is not a valid distance file
+  bool open( const std::string &path, bool isUpdate = false );
+
+  // Write any pending changes and unmap the file. Returns false if the
+  // changes could not be written
+  bool close();
+
+  // Return the number of sequences in the matrix
+  size_t getNumSeqs() const;
+
+  // Return the type used to store the distances
+  DistStorage getStorage() const;
+
+  // Return the names of the sequences
+  std::vector< std::string > getSeqNames() const;
+
+  // Return the number of sequences in a block of a tile
+  size_t getBlockSize() const;
+
+  // Return the number of tiles in the lower triangle
+  size_t getNumTiles() const;
+
+  // Return true if the distances of the tile are done
+  bool isTileDone( size_t tile ) const;
+
+  // Return true if every tile is done. Always true for a file that is not
+  // written by tiles
+  bool isComplete() const;
+
+  // Write the distances to disk and then mark the tile as done. Returns
+  // false if the distances could not be written
+  bool setTileDone( size_t tile );
+
+  // Return a pointer to the start of the condensed lower triangle
+  const void *getData() const;
+
+  // Copy the distances in the condensed lower triangle to a buffer of
+  // doubles
+  void copyDists( double *outDists ) const;
+
+  // Return an output that writes to the condensed lower triangle of a file
+  // that was created for writing
+  DistOutput getOutput();
+
+private:
+
+  // Pointer to the start of the mapped file
+  char *data;
+
+  // Size of the mapped file
+  size_t dataSize;
+
+  // Header of the open file
+  const DistFileHeader *header;
+
+  // Bool indicating that the file was created for writing
+  bool isWritable;
+
+  // Path to the file, used to write the buffer where mmap is not availible
+  std::string filePath;
+
+  // Buffer with the file contents where mmap is not available
+  std::vector< char > fileBuf;
+
+  // Check that the sections in the header are inside of the file
+  bool isValidHeader() const;
+
+  // Return the ranges of bytes, as offsets and lengths, of the distances
+  // in the tile. Each column of the tile is a contiguous range
+  std::vector< std::pair< size_t, size_t > > getTileRanges(
+    size_t tile ) const;
+
+  // Write the changes to the file in the ranges of bytes to disk
+  bool syncRanges( const std::vector< std::pair< size_t, size_t > > &ranges );
+};
+#endif
+
+// -----------------------------------------------------------------------------
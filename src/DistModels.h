@@ -0,0 +1,136 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+// -----------------------------------------------------------------------------
+// DistModels
+// Ryan D. Crawford
+// 2020/12/17
+// -----------------------------------------------------------------------------
+// These are the models that convert the counts of the differences between
+// two sequences into a distance. Each model is a type with a static
+// function, so the tile kernels of MsaDistance are templates on the model
+// and the model is chosen once for the matrix instead of once for each pair.
+// The counts are the mismatches and the shared valid sites of the pair, and
+// the transitions when the model needs them. The corrected distances are
+// infinite when the sequences are too different for the correction, and
+// every distance is zero when the pair has no shared sites.
+// -----------------------------------------------------------------------------
+
+#ifndef _DIST_MODELS_
+#define _DIST_MODELS_
+
+// The models of the distance between two sequences
+enum DistModel
+{
+  MODEL_RAW     = 0,
+  MODEL_SHARED  = 1,
+  MODEL_JC69    = 2,
+  MODEL_K2P     = 3,
+  MODEL_POISSON = 4,
+  MODEL_SCORE   = 5
+};
+
+// Counts of the differences between two sequences
+struct DiffCounts
+{
+  // Default ctor: no differences
+  DiffCounts(): mismatches( 0 ), sites( 0 ), transitions( 0 )
+  { ; }
+
+  // Add or remove the counts of another window of positions
+  inline DiffCounts &operator+=( const DiffCounts &counts )
+  {
+    mismatches  += counts.mismatches;
+    sites       += counts.sites;
+    transitions += counts.transitions;
+    return *this;
+  }
+  inline DiffCounts &operator-=( const DiffCounts &counts )
+  {
+    mismatches  -= counts.mismatches;
+    sites       -= counts.sites;
+    transitions -= counts.transitions;
+    return *this;
+  }
+
+  // Number of positions where the sequences have different symbols
+  uint64_t mismatches;
+
+  // Number of positions where both sequences have a residue
+  uint64_t sites;
+
+  // Number of mismatches between two purines or two pyrimidines
+  uint64_t transitions;
+};
+
+// The raw number of mismatches
+struct RawModel
+{
+  static const bool NEEDS_TRANSITIONS = false;
+  static inline double calcDist( const DiffCounts &counts )
+  {
+    return counts.mismatches;
+  }
+};
+
+// The mismatches per shared site, the "p-distance"
+struct SharedModel
+{
+  static const bool NEEDS_TRANSITIONS = false;
+  static inline double calcDist( const DiffCounts &counts )
+  {
+    if ( counts.sites == 0 ) return 0;
+    return counts.mismatches / (double) counts.sites;
+  }
+};
+
+// The Jukes-Cantor distance between nucleotide sequences
+struct Jc69Model
+{
+  static const bool NEEDS_TRANSITIONS = false;
+  static inline double calcDist( const DiffCounts &counts )
+  {
+    if ( counts.sites == 0 ) return 0;
+    double arg = 1 - 4.0 / 3.0 * counts.mismatches / counts.sites;
+    if ( arg <= 0 ) return std::numeric_limits< double >::infinity();
+    return -0.75 * std::log( arg );
+  }
+};
+
+// The Kimura two parameter distance between nucleotide sequences, with
+// separate rates for the transitions and transversions
+struct K2pModel
+{
+  static const bool NEEDS_TRANSITIONS = true;
+  static inline double calcDist( const DiffCounts &counts )
+  {
+    if ( counts.sites == 0 ) return 0;
+    double fracTs = counts.transitions / (double) counts.sites;
+    double fracTv =
+      ( counts.mismatches - counts.transitions ) / (double) counts.sites;
+    double argTs  = 1 - 2 * fracTs - fracTv;
+    double argTv  = 1 - 2 * fracTv;
+    if ( argTs <= 0 || argTv <= 0 )
+      return std::numeric_limits< double >::infinity();
+    return -0.5 * std::log( argTs ) - 0.25 * std::log( argTv );
+  }
+};
+
+// The Poisson corrected distance between amino acid sequences
+struct PoissonModel
+{
+  static const bool NEEDS_TRANSITIONS = false;
+  static inline double calcDist( const DiffCounts &counts )
+  {
+    if ( counts.sites == 0 ) return 0;
+    double arg = 1 - counts.mismatches / (double) counts.sites;
+    if ( arg <= 0 ) return std::numeric_limits< double >::infinity();
+    return -std::log( arg );
+  }
+};
+#endif
+
+// -----------------------------------------------------------------------------
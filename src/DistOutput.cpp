@@ -0,0 +1,103 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstring>
+#include "DistOutput.h"
+
+// -----------------------------------------------------------------------------
+// DistOutput
+// Ryan D. Crawford
+// 2020/12/14
+// -----------------------------------------------------------------------------
+
+DistOutput::DistOutput( Rcpp::NumericMatrix distMat ):
+  data( distMat.begin() ), numSeqs( distMat.nrow() ), storage( DIST_DOUBLE ),
+  isDense( true )
+{ ; }
+
+DistOutput::DistOutput( void *data, size_t numSeqs, DistStorage storage ):
+  data( data ), numSeqs( numSeqs ), storage( storage ), isDense( false )
+{ ; }
+
+// Return true if the distances are written to a full matrix
+bool DistOutput::getIsDense() const
+{
+  return isDense;
+}
+
+// Copy the distances between the first "oldNumSeqs" sequences from a matrix
+// with the same layout and storage type
+void DistOutput::copyDists( const void *oldData, size_t oldNumSeqs )
+{
+  if ( oldNumSeqs > numSeqs )
+    Rcpp::stop( "The matrix has more sequences than the output" );
+  const char *oldBytes = static_cast< const char * >( oldData );
+  char       *newBytes = static_cast< char * >( data );
+
+  // Each column of the old matrix is the start of the same column of the
+  // output, in both the full matrix and the condensed lower triangle
+  size_t valBytes = getStorageBytes( storage );
+  for ( size_t j = 0; j < oldNumSeqs; j++ )
+  {
+    if ( isDense )
+    {
+      std::memcpy( newBytes + j * numSeqs * valBytes,
+        oldBytes + j * oldNumSeqs * valBytes, oldNumSeqs * valBytes );
+    }
+    else if ( j + 1 < oldNumSeqs )
+    {
+      std::memcpy(
+        newBytes + getCondensedIdx( numSeqs, j + 1, j ) * valBytes,
+        oldBytes + getCondensedIdx( oldNumSeqs, j + 1, j ) * valBytes,
+        ( oldNumSeqs - j - 1 ) * valBytes );
+    }
+  }
+}
+
+// Return the number of distances in the condensed lower triangle
+size_t DistOutput::getCondensedSize( size_t numSeqs )
+{
+  return numSeqs ? numSeqs * ( numSeqs - 1 ) / 2 : 0;
+}
+
+// Return the number of bytes used to store a distance
+size_t DistOutput::getStorageBytes( DistStorage storage )
+{
+  return storage == DIST_DOUBLE ? sizeof( double ) : 4;
+}
+
+// Convert the name of a storage type to the type
+DistStorage DistOutput::parseStorage( const std::string &storageName )
+{
+  if ( storageName == "double" )  return DIST_DOUBLE;
+  if ( storageName == "integer" ) return DIST_INT;
+  if ( storageName == "float" )   return DIST_FLOAT;
+  if ( storageName == "uint32" )  return DIST_UINT32;
+
+  Rcpp::stop( "Storage type " + storageName + " is not supported\n" +
+    "Supported types are:\n  -- double\n  -- integer\n  -- float\n" +
+    "  -- uint32" );
+}
+
+// Stop with an error if the distances of the input method cannot be stored
+// with the storage type
+void DistOutput::checkStorage( const std::string &method, DistStorage storage )
+{
+  if ( ( storage == DIST_INT || storage == DIST_UINT32 ) && method != "raw" )
+    Rcpp::stop( "Only \"raw\" distances can be stored as integers" );
+}
+
+// Set the attributes of a condensed lower triangle so it is an R "dist"
+// object
+void DistOutput::setDistAttrs( Rcpp::RObject distObj,
+  const std::vector< std::string > &seqNames, const std::string &method
+  )
+{
+  distObj.attr( "Size" )   = (int) seqNames.size();
+  distObj.attr( "Labels" ) = Rcpp::wrap( seqNames );
+  distObj.attr( "Diag" )   = false;
+  distObj.attr( "Upper" )  = false;
+  if ( !method.empty() ) distObj.attr( "method" ) = method;
+  distObj.attr( "class" )  = "dist";
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,120 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// DistOutput
+// Ryan D. Crawford
+// 2020/12/14
+// -----------------------------------------------------------------------------
+// This class is the destination of the pairwise distances between the
+// sequences in an alignment. The distances are either written to a full
+// column-major matrix of doubles, or to the condensed lower triangle of the
+// matrix in the order used by R "dist" objects. The condensed triangle can be
+// stored as doubles, 32 bit integers, 32 bit floats or unsigned 32 bit
+// integers. The class does not own the memory it writes to, so the same
+// object writes to an R matrix or vector, or to a mapped distance file.
+// -----------------------------------------------------------------------------
+
+#ifndef _DIST_OUTPUT_
+#define _DIST_OUTPUT_
+
+// The types used to store the distances
+enum DistStorage
+{
+  DIST_DOUBLE = 0,
+  DIST_INT    = 1,
+  DIST_FLOAT  = 2,
+  DIST_UINT32 = 3
+};
+
+class DistOutput
+{
+public:
+
+  // Value ctor: writes the distances to a full matrix of doubles
+  DistOutput( Rcpp::NumericMatrix distMat );
+
+  // Value ctor: writes the distances to the condensed lower triangle of
+  // the matrix with "numSeqs" sequences stored with the input type
+  DistOutput( void *data, size_t numSeqs, DistStorage storage );
+
+  // Set the distance between sequences i and j, where i > j
+  inline void set( size_t i, size_t j, double val )
+  {
+    if ( isDense )
+    {
+      static_cast< double * >( data )[ i + j * numSeqs ] = val;
+      return;
+    }
+
+    size_t idx = getCondensedIdx( numSeqs, i, j );
+    switch ( storage )
+    {
+      case DIST_DOUBLE: static_cast< double * >( data )[ idx ]   = val; break;
+      case DIST_INT:    static_cast< int * >( data )[ idx ]      = val; break;
+      case DIST_FLOAT:  static_cast< float * >( data )[ idx ]    = val; break;
+      case DIST_UINT32: static_cast< uint32_t * >( data )[ idx ] = val; break;
+    }
+  }
+
+  // Copy the distance between sequences i and j, where i > j, to the upper
+  // triangle of a full matrix. Does nothing for the condensed triangle
+  inline void mirror( size_t i, size_t j )
+  {
+    if ( !isDense ) return;
+    double *mat = static_cast< double * >( data );
+    mat[ j + i * numSeqs ] = mat[ i + j * numSeqs ];
+  }
+
+  // Return true if the distances are written to a full matrix
+  bool getIsDense() const;
+
+  // Copy the distances between the first "oldNumSeqs" sequences from a
+  // matrix with the same layout and storage type as the output
+  void copyDists( const void *oldData, size_t oldNumSeqs );
+
+  // Return the position of the distance between sequences i and j, where
+  // i > j, in the condensed lower triangle
+  static inline size_t getCondensedIdx( size_t numSeqs, size_t i, size_t j )
+  {
+    return j * ( 2 * numSeqs - j - 1 ) / 2 + ( i - j - 1 );
+  }
+
+  // Return the number of distances in the condensed lower triangle
+  static size_t getCondensedSize( size_t numSeqs );
+
+  // Return the number of bytes used to store a distance
+  static size_t getStorageBytes( DistStorage storage );
+
+  // Convert the name of a storage type to the type. Supported types are
+  // "double", "integer", "float" and "uint32"
+  static DistStorage parseStorage( const std::string &storageName );
+
+  // Stop with an error if the distances of the input method cannot be
+  // stored with the storage type. Only the "raw" distances are counts that
+  // can be stored as integers
+  static void checkStorage( const std::string &method, DistStorage storage );
+
+  // Set the attributes of a condensed lower triangle so it is an R "dist"
+  // object with the input sequence names as labels
+  static void setDistAttrs( Rcpp::RObject distObj,
+    const std::vector< std::string > &seqNames, const std::string &method );
+
+private:
+
+  // Pointer to the memory the distances are written to
+  void *data;
+
+  // Number of sequences in the alignment
+  size_t numSeqs;
+
+  // Type used to store the distances
+  DistStorage storage;
+
+  // Bool indicating that the distances are written to a full matrix
+  bool isDense;
+};
+#endif
+
+// -----------------------------------------------------------------------------
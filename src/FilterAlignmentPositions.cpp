@@ -13,7 +13,7 @@
 //' @description
 //'   This function removes gaps and/or positions without sufficient varition
 //'   from the alingment.
-//' @param msaPath Path to the alignment
+//' @param msaPath Path to the alignment in fasta or binary format
 //' @param filterMsaPath Path to write the filtered alignment
 //' @param minGapFrac Double representing the minimium fraction of gaps to
 //'   remain in the alignment.Defaults to 0.01.
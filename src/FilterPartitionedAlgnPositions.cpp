@@ -12,7 +12,7 @@
 //' @title Filter Partitioned Algn Positions
 //' @description
 //'   This function
-//' @param msaPath Path to the alignment
+//' @param msaPath Path to the alignment in fasta or binary format
 //' @param filterMsaPath Path to write the filtered alignment
 //' @param genePositions Vector of gene partitions in the alignment
 //' @param minGapFrac Double representing the minimium fraction of gaps to
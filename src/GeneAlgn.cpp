@@ -0,0 +1,103 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "GeneAlgn.h"
+
+// -----------------------------------------------------------------------------
+// GeneAlgn
+// Ryan D. Crawford
+// 2020/12/07
+// -----------------------------------------------------------------------------
+
+GenomeIndex::GenomeIndex( const std::vector< std::string > &genomeNames )
+{
+  genomeIdx.reserve( genomeNames.size() );
+  for ( size_t i = 0; i < genomeNames.size(); i++ )
+    genomeIdx.emplace( genomeNames[ i ], i );
+}
+
+// Return the position of a genome, or -1 if it is not in the analysis
+int GenomeIndex::getGenomeIdx( const std::string &genomeName ) const
+{
+  auto it = genomeIdx.find( genomeName );
+  if ( it == genomeIdx.end() ) return -1;
+  return it->second;
+}
+
+// Return the position of the genome a gene is from
+int GenomeIndex::getGeneGenomeIdx( const std::string &geneId ) const
+{
+  size_t start = geneId.find( "fig|" );
+  size_t end   = geneId.find( ".peg" );
+  if ( start == std::string::npos || end == std::string::npos ) return -1;
+  return getGenomeIdx( geneId.substr( start + 4, end - start - 4 ) );
+}
+
+// Return the number of genomes
+int GenomeIndex::size() const
+{
+  return genomeIdx.size();
+}
+
+// Set the alignment from the aligned representative genes and the genes
+// in the cluster
+bool GeneAlgn::setAlgn( const std::vector< std::string > &algn,
+  const std::vector< std::string > &geneIds,
+  const std::vector< int > &geneReps, const GenomeIndex &genomeIndex
+  )
+{
+  algnLen = algn.size() ? algn[ 0 ].size() : 0;
+
+  // Copy the aligned rows into the buffer
+  rows.clear();
+  rows.reserve( algn.size() * algnLen );
+  for ( auto &row : algn )
+  {
+    if ( row.size() != algnLen ) return false;
+    rows += row;
+  }
+
+  // Point each genome at the row of the representative of its first gene
+  rowIdxs.assign( genomeIndex.size(), -1 );
+  for ( size_t i = 0; i < geneIds.size(); i++ )
+  {
+    int genomeIdx = genomeIndex.getGeneGenomeIdx( geneIds[ i ] );
+    if ( genomeIdx < 0 || rowIdxs[ genomeIdx ] >= 0 ) continue;
+    if ( geneReps[ i ] < 0 || geneReps[ i ] >= (int) algn.size() )
+      return false;
+    rowIdxs[ genomeIdx ] = geneReps[ i ];
+  }
+
+  return true;
+}
+
+// Return the length of the alignment
+size_t GeneAlgn::getAlgnLen() const
+{
+  return algnLen;
+}
+
+// Return the number of distinct rows in the alignment
+size_t GeneAlgn::getNumRows() const
+{
+  return algnLen ? rows.size() / algnLen : 0;
+}
+
+// Return a pointer to the start of a row in the buffer
+const char *GeneAlgn::getRow( int rowIdx ) const
+{
+  return rows.data() + (size_t) rowIdx * algnLen;
+}
+
+// Return the index of the row for each genome, -1 if the gene is missing
+const std::vector< int > &GeneAlgn::getRowIdxs() const
+{
+  return rowIdxs;
+}
+
+// Return true if the genome is missing this gene
+bool GeneAlgn::isMissing( int genomeIdx ) const
+{
+  return rowIdxs[ genomeIdx ] < 0;
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,92 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <unordered_map>
+
+// -----------------------------------------------------------------------------
+// GeneAlgn
+// Ryan D. Crawford
+// 2020/12/07
+// -----------------------------------------------------------------------------
+// These classes store the alignment of a single gene in the order of the
+// genomes in the analysis. The genome index maps each genome name to its
+// position with a hash table. The gene alignment keeps the distinct aligned
+// rows in a single buffer and the index of the row used by each genome.
+// Identical genes share the row of their representative, so duplicated
+// genes are never copied, and genomes without the gene are flagged with a
+// row index of -1 instead of a row of gaps.
+// -----------------------------------------------------------------------------
+
+#ifndef _GENOME_INDEX_
+#define _GENOME_INDEX_
+class GenomeIndex
+{
+public:
+
+  // Value ctor: takes the names of the genomes in the analysis
+  GenomeIndex( const std::vector< std::string > &genomeNames );
+
+  // Return the position of a genome, or -1 if it is not in the analysis
+  int getGenomeIdx( const std::string &genomeName ) const;
+
+  // Return the position of the genome a gene is from. The gene ids are in
+  // the format "fig|genomeName.peg.N"
+  int getGeneGenomeIdx( const std::string &geneId ) const;
+
+  // Return the number of genomes
+  int size() const;
+
+private:
+
+  // Position of each genome in the analysis
+  std::unordered_map< std::string, int > genomeIdx;
+};
+#endif
+
+#ifndef _GENE_ALGN_
+#define _GENE_ALGN_
+class GeneAlgn
+{
+public:
+
+  // Default ctor: an empty alignment
+  GeneAlgn(): algnLen( 0 )
+  { ; }
+
+  // Set the alignment from the aligned representative genes and the genes
+  // in the cluster, in the order of the cluster. "geneReps" has the index of
+  // the representative of each gene in the aligned rows. The first gene of
+  // each genome in the cluster is used. Returns false if the aligned rows
+  // are not all the same length.
+  bool setAlgn( const std::vector< std::string > &algn,
+    const std::vector< std::string > &geneIds,
+    const std::vector< int > &geneReps, const GenomeIndex &genomeIndex );
+
+  // Return the length of the alignment
+  size_t getAlgnLen() const;
+
+  // Return the number of distinct rows in the alignment
+  size_t getNumRows() const;
+
+  // Return a pointer to the start of a row in the buffer
+  const char *getRow( int rowIdx ) const;
+
+  // Return the index of the row for each genome, -1 if the gene is missing
+  const std::vector< int > &getRowIdxs() const;
+
+  // Return true if the genome is missing this gene
+  bool isMissing( int genomeIdx ) const;
+
+private:
+
+  // Length of the alignment
+  size_t algnLen;
+
+  // Buffer with the distinct aligned rows stored one after another
+  std::string rows;
+
+  // Index of the row used by each genome, -1 if the genome is missing
+  std::vector< int > rowIdxs;
+};
+#endif
+
+// -----------------------------------------------------------------------------
@@ -8,13 +8,14 @@
 // Ryan D. Crawford
 // 05/15/2020
 // -----------------------------------------------------------------------------
-// This function reads in the path to a multiple sequence alignment, and Then
-// generates a distance matrix at each of the partions specified in the input
-// vector, which specifies the end of the partitions.
+// This function reads in the path to a multiple sequence alignment and
+// scores the alignment in sliding windows. Each row of the returned matrix
+// has the start and end of a window and the minimum, quartiles, maximum and
+// mean of the distances between the sequences in the window.
 // -----------------------------------------------------------------------------
 
 // [[Rcpp::export]]
-std::vector< double > GetAlgnQualScores(
+Rcpp::NumericMatrix GetAlgnQualScores(
   std::string msaPath, std::string method, int stepVal, int windowSize
   )
 {
@@ -24,8 +25,7 @@ std::vector< double > GetAlgnQualScores(
   // Read in the fasta file and check that this is a valid alignmnet
   multiSeqAlgn.parseMsa();
 
-  // Create a distance matrix with the raw alignment distances -- number
-  // of mutations between each pair of sequences
+  // Score the windows with the distances between each pair of sequences
   return multiSeqAlgn.calcAlgnQualScores( method, stepVal, windowSize );
 }
 
@@ -0,0 +1,380 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <mutex>
+#ifdef _WIN32
+#include <fstream>
+#include <thread>
+#include <functional>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+#include "MafftRunner.h"
+
+// -----------------------------------------------------------------------------
+// MafftRunner
+// Ryan D. Crawford
+// 2020/11/23
+// -----------------------------------------------------------------------------
+
+MafftRunner::MafftRunner(
+  const std::string &tmpDir, const std::string &mafftOpts
+  ):
+  tmpDir( tmpDir )
+{
+  // Split the options into the individual arguments
+  std::istringstream iss( mafftOpts );
+  std::string arg;
+  while ( iss >> arg ) mafftArgs.push_back( arg );
+
+  // mafft does not expect a trailing '/' in the temporary directory
+  while ( this->tmpDir.size() > 1 && this->tmpDir.back() == '/' )
+    this->tmpDir.pop_back();
+}
+
+// Align the input sequences with mafft using the given number of threads
+bool MafftRunner::align( const std::vector< std::string > &seqIds,
+  const std::vector< std::string > &seqs,
+  const std::vector< std::string > &addIds,
+  const std::vector< std::string > &addSeqs, int numThreads,
+  std::vector< std::string > &algnIds, std::vector< std::string > &algn
+  )
+{
+  std::string outFasta;
+  bool isSuccess = runMafft( numThreads, toFasta( seqIds, seqs ),
+    toFasta( addIds, addSeqs ), outFasta );
+  if ( !isSuccess ) return false;
+
+  algnIds.clear();
+  algn.clear();
+  parseFasta( outFasta, algnIds, algn );
+
+  return algn.size() == seqs.size() + addSeqs.size();
+}
+
+// Create the arguments for a mafft run
+std::vector< std::string > MafftRunner::getArgs( int numThreads, bool isAdd,
+  const std::string &inPath, const std::string &addPath
+  )
+{
+  std::vector< std::string > args( 1, "mafft" );
+
+  // If the user did not set the number of threads, use the budget for the
+  // job
+  if ( std::find( mafftArgs.begin(), mafftArgs.end(), "--thread" ) ==
+    mafftArgs.end() )
+  {
+    args.push_back( "--thread" );
+    args.push_back( std::to_string( numThreads ) );
+  }
+
+  if ( isAdd )
+  {
+    args.push_back( "--add" );
+    args.push_back( addPath );
+    args.push_back( "--keeplength" );
+  }
+
+  args.insert( args.end(), mafftArgs.begin(), mafftArgs.end() );
+  args.push_back( inPath );
+  return args;
+}
+
+// Write the sequences in the fasta format to a string
+std::string MafftRunner::toFasta( const std::vector< std::string > &ids,
+  const std::vector< std::string > &seqs
+  )
+{
+  size_t faLen = 0;
+  for ( unsigned int i = 0; i < seqs.size(); i++ )
+    faLen += ids[ i ].size() + seqs[ i ].size() + 3;
+
+  std::string fasta;
+  fasta.reserve( faLen );
+  for ( unsigned int i = 0; i < seqs.size(); i++ )
+  {
+    fasta += '>';
+    fasta += ids[ i ];
+    fasta += '\n';
+    fasta += seqs[ i ];
+    fasta += '\n';
+  }
+  return fasta;
+}
+
+// Parse the fasta formatted alignment output by mafft. The sequences are
+// converted to upper case to match the sequences read by BioSeq.
+void MafftRunner::parseFasta( const std::string &fasta,
+  std::vector< std::string > &algnIds, std::vector< std::string > &algn
+  )
+{
+  size_t pos = 0;
+  while ( pos < fasta.size() )
+  {
+    size_t end = fasta.find( '\n', pos );
+    if ( end == std::string::npos ) end = fasta.size();
+
+    if ( fasta[ pos ] == '>' )
+    {
+      algnIds.push_back( fasta.substr( pos + 1, end - pos - 1 ) );
+      algn.push_back( "" );
+    }
+    else if ( algn.size() )
+    {
+      std::string &seq = algn.back();
+      for ( size_t i = pos; i < end; i++ )
+        if ( fasta[ i ] != '\r' ) seq.push_back( std::toupper( fasta[ i ] ) );
+    }
+    pos = end + 1;
+  }
+}
+
+#ifdef _WIN32
+
+// Run mafft with the shell using temporary files for the input and output
+bool MafftRunner::runMafft( int numThreads, const std::string &inFasta,
+  const std::string &addFasta, std::string &outFasta
+  )
+{
+  std::string prefix = tmpDir + "/mafft_" + std::to_string(
+    std::hash< std::thread::id >()( std::this_thread::get_id() ) );
+  std::string inPath  = prefix + "_in.fasta";
+  std::string addPath = prefix + "_add.fasta";
+  std::string outPath = prefix + "_out.fasta";
+
+  std::ofstream ofs( inPath.c_str() );
+  ofs << inFasta;
+  ofs.close();
+  if ( addFasta.size() )
+  {
+    std::ofstream addOfs( addPath.c_str() );
+    addOfs << addFasta;
+    addOfs.close();
+  }
+
+  std::string mafftCmd;
+  for ( auto &arg : getArgs( numThreads, !addFasta.empty(), inPath, addPath ) )
+    mafftCmd += arg + ' ';
+  mafftCmd += "> " + outPath;
+
+  bool isSuccess = std::system( mafftCmd.c_str() ) == 0;
+  if ( isSuccess )
+  {
+    std::ifstream ifs( outPath.c_str() );
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    outFasta = buffer.str();
+  }
+
+  std::remove( inPath.c_str() );
+  std::remove( addPath.c_str() );
+  std::remove( outPath.c_str() );
+  return isSuccess;
+}
+
+#else
+
+// Guards the creation of pipes and the spawning of mafft, so a process
+// spawned by one thread never inherits the pipes of another thread before
+// they are marked close-on-exec
+static std::mutex spawnMtx;
+
+// Create a pipe with both ends closed on exec
+static bool createPipe( int fds[ 2 ] )
+{
+  if ( pipe( fds ) != 0 ) return false;
+  fcntl( fds[ 0 ], F_SETFD, FD_CLOEXEC );
+  fcntl( fds[ 1 ], F_SETFD, FD_CLOEXEC );
+  return true;
+}
+
+// Close a file descriptor if it is open and mark it as closed
+static void closeFd( int &fd )
+{
+  if ( fd >= 0 ) close( fd );
+  fd = -1;
+}
+
+// Run mafft with posix_spawn, writing the input to its standard input and
+// reading the alignment from its standard output
+bool MafftRunner::runMafft( int numThreads, const std::string &inFasta,
+  const std::string &addFasta, std::string &outFasta
+  )
+{
+  bool isAdd = !addFasta.empty();
+
+  // Create the arguments and the environment of the child process. mafft
+  // reads the input from "-" and the sequences to add from file descriptor
+  // 3. The temporary directory is passed to mafft with TMPDIR
+  std::vector< std::string > args = getArgs(
+    numThreads, isAdd, "-", "/dev/fd/3" );
+  std::vector< char * > argv;
+  for ( auto &arg : args )
+    argv.push_back( const_cast< char * >( arg.c_str() ) );
+  argv.push_back( NULL );
+
+  std::string tmpVar = "TMPDIR=" + tmpDir;
+  std::vector< char * > envp;
+  for ( char **env = environ; *env; env++ )
+    if ( std::strncmp( *env, "TMPDIR=", 7 ) || tmpDir.empty() )
+      envp.push_back( *env );
+  if ( !tmpDir.empty() )
+    envp.push_back( const_cast< char * >( tmpVar.c_str() ) );
+  envp.push_back( NULL );
+
+  // Pipes for the standard input, standard output and the added sequences
+  int inFds[ 2 ]  = { -1, -1 };
+  int outFds[ 2 ] = { -1, -1 };
+  int addFds[ 2 ] = { -1, -1 };
+  pid_t pid;
+  {
+    std::lock_guard< std::mutex > lock( spawnMtx );
+    if ( !createPipe( inFds ) || !createPipe( outFds ) ||
+      ( isAdd && !createPipe( addFds ) ) )
+    {
+      closeFd( inFds[ 0 ] );
+      closeFd( inFds[ 1 ] );
+      closeFd( outFds[ 0 ] );
+      closeFd( outFds[ 1 ] );
+      closeFd( addFds[ 0 ] );
+      return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_adddup2( &actions, inFds[ 0 ], STDIN_FILENO );
+    posix_spawn_file_actions_adddup2( &actions, outFds[ 1 ], STDOUT_FILENO );
+    if ( isAdd ) posix_spawn_file_actions_adddup2( &actions, addFds[ 0 ], 3 );
+
+    // mafft is run with the default signal mask, since the worker threads
+    // block SIGPIPE
+    posix_spawnattr_t attr;
+    posix_spawnattr_init( &attr );
+    sigset_t emptyMask;
+    sigemptyset( &emptyMask );
+    posix_spawnattr_setsigmask( &attr, &emptyMask );
+    posix_spawnattr_setflags( &attr, POSIX_SPAWN_SETSIGMASK );
+
+    int status = posix_spawnp(
+      &pid, "mafft", &actions, &attr, argv.data(), envp.data() );
+
+    posix_spawn_file_actions_destroy( &actions );
+    posix_spawnattr_destroy( &attr );
+
+    // Close the ends of the pipes used by mafft
+    closeFd( inFds[ 0 ] );
+    closeFd( outFds[ 1 ] );
+    closeFd( addFds[ 0 ] );
+
+    if ( status != 0 )
+    {
+      closeFd( inFds[ 1 ] );
+      closeFd( outFds[ 0 ] );
+      closeFd( addFds[ 1 ] );
+      return false;
+    }
+  }
+
+  // Block SIGPIPE in this thread, so mafft exiting early is reported as an
+  // error when writing instead of terminating the R session
+  sigset_t pipeMask, oldMask;
+  sigemptyset( &pipeMask );
+  sigaddset( &pipeMask, SIGPIPE );
+  pthread_sigmask( SIG_BLOCK, &pipeMask, &oldMask );
+
+  fcntl( inFds[ 1 ], F_SETFL, O_NONBLOCK );
+  if ( isAdd ) fcntl( addFds[ 1 ], F_SETFL, O_NONBLOCK );
+
+  // Write the input and read the output as mafft is ready for them, so
+  // neither process blocks on a full pipe
+  size_t inPos  = 0;
+  size_t addPos = 0;
+  bool   isPipeErr = false;
+  char   buffer[ 65536 ];
+  outFasta.clear();
+  if ( inFasta.empty() ) closeFd( inFds[ 1 ] );
+  if ( addFasta.empty() ) closeFd( addFds[ 1 ] );
+
+  while ( outFds[ 0 ] >= 0 )
+  {
+    struct pollfd fds[ 3 ];
+    int nFds = 0;
+    fds[ nFds++ ] = { outFds[ 0 ], POLLIN, 0 };
+    if ( inFds[ 1 ] >= 0 ) fds[ nFds++ ] = { inFds[ 1 ], POLLOUT, 0 };
+    if ( addFds[ 1 ] >= 0 ) fds[ nFds++ ] = { addFds[ 1 ], POLLOUT, 0 };
+
+    if ( poll( fds, nFds, -1 ) < 0 )
+    {
+      if ( errno == EINTR ) continue;
+      break;
+    }
+
+    for ( int i = 0; i < nFds; i++ )
+    {
+      if ( !fds[ i ].revents ) continue;
+
+      if ( fds[ i ].fd == outFds[ 0 ] )
+      {
+        ssize_t n = read( outFds[ 0 ], buffer, sizeof( buffer ) );
+        if ( n > 0 ) outFasta.append( buffer, n );
+        else if ( n == 0 || errno != EINTR ) closeFd( outFds[ 0 ] );
+        continue;
+      }
+
+      // Write the next chunk of the input or the sequences to add
+      bool isIn = fds[ i ].fd == inFds[ 1 ];
+      int &fd = isIn ? inFds[ 1 ] : addFds[ 1 ];
+      const std::string &data = isIn ? inFasta : addFasta;
+      size_t &pos = isIn ? inPos : addPos;
+
+      ssize_t n = write( fd, data.data() + pos, data.size() - pos );
+      if ( n > 0 ) pos += n;
+      else if ( n < 0 && errno != EAGAIN && errno != EINTR )
+      {
+        isPipeErr = true;
+        closeFd( fd );
+      }
+      if ( pos == data.size() ) closeFd( fd );
+    }
+  }
+
+  closeFd( inFds[ 1 ] );
+  closeFd( addFds[ 1 ] );
+  closeFd( outFds[ 0 ] );
+
+  // Discard a SIGPIPE raised by writing to a closed pipe and restore the
+  // signal mask of the thread
+  if ( isPipeErr )
+  {
+    struct timespec noWait = { 0, 0 };
+    sigtimedwait( &pipeMask, NULL, &noWait );
+  }
+  pthread_sigmask( SIG_SETMASK, &oldMask, NULL );
+
+  // Wait for mafft to exit. If the child was already reaped, by a SIGCHLD
+  // handler or with SIGCHLD ignored, its exit status is unknown and the
+  // run is treated as a failure
+  int   status = 0;
+  pid_t waitRes;
+  while ( ( waitRes = waitpid( pid, &status, 0 ) ) < 0 && errno == EINTR )
+  { ; }
+  if ( waitRes < 0 ) return false;
+
+  return !isPipeErr && WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
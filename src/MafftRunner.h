@@ -0,0 +1,69 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+
+// -----------------------------------------------------------------------------
+// MafftRunner
+// Ryan D. Crawford
+// 2020/11/23
+// -----------------------------------------------------------------------------
+// This class runs mafft on a set of sequences without writing any fasta
+// files. mafft is started with posix_spawn, the sequences are streamed to
+// its standard input over a pipe and the alignment is parsed directly from
+// its standard output. When sequences are added to an existing alignment,
+// the new sequences are streamed over a second pipe which mafft reads as
+// "/dev/fd/3". The options passed to mafft are split on white space and
+// passed as arguments without a shell. The temporary files mafft creates
+// internally are put in the directory supplied to the constructor. On
+// Windows, where posix_spawn is not available, the sequences are written to
+// temporary files and mafft is run with the shell.
+// -----------------------------------------------------------------------------
+
+#ifndef _MAFFT_RUNNER_
+#define _MAFFT_RUNNER_
+class MafftRunner
+{
+public:
+
+  // Value ctor: takes the directory for temporary files and the options
+  // passed to mafft
+  MafftRunner( const std::string &tmpDir, const std::string &mafftOpts );
+
+  // Align the input sequences with mafft using the given number of threads.
+  // If there are sequences to add, the input sequences are treated as an
+  // existing alignment and the new sequences are aligned to it keeping the
+  // length of the alignment. Returns true if mafft exited sucessfully and
+  // returned a sequence for every input.
+  bool align( const std::vector< std::string > &seqIds,
+    const std::vector< std::string > &seqs,
+    const std::vector< std::string > &addIds,
+    const std::vector< std::string > &addSeqs, int numThreads,
+    std::vector< std::string > &algnIds, std::vector< std::string > &algn );
+
+private:
+
+  // Directory for the temporary files created by mafft
+  std::string tmpDir;
+
+  // Options passed to mafft split into individual arguments
+  std::vector< std::string > mafftArgs;
+
+  // Create the arguments for a mafft run
+  std::vector< std::string > getArgs( int numThreads, bool isAdd,
+    const std::string &inPath, const std::string &addPath );
+
+  // Write the sequences in the fasta format to a string
+  std::string toFasta( const std::vector< std::string > &ids,
+    const std::vector< std::string > &seqs );
+
+  // Parse the fasta formatted alignment output by mafft
+  void parseFasta( const std::string &fasta,
+    std::vector< std::string > &algnIds, std::vector< std::string > &algn );
+
+  // Run mafft with the fasta formatted input and the sequences to add, if
+  // any, and store the output. Returns true if mafft exited sucessfully
+  bool runMafft( int numThreads, const std::string &inFasta,
+    const std::string &addFasta, std::string &outFasta );
+};
+#endif
+
+// -----------------------------------------------------------------------------
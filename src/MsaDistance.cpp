@@ -2,6 +2,7 @@
 // [[Rcpp::plugins(cpp11)]]
 #include <RcppParallel.h>
 #include <Rcpp.h>
+#include <algorithm>
 #include "MsaDistance.h"
 #include "AlgnSubCalc.h"
 using namespace Rcpp;
@@ -13,192 +14,723 @@ using namespace RcppParallel;
 // 2020/01/23
 // -----------------------------------------------------------------------------
 
-// Set the function pointer to the type specified by the input
-// argument "distFunType"
-void MsaDistance::setDistFunc( std::string distFunType )
+// Set the distance model to the type specified by the input argument
+// "distFunType"
+void MsaDistance::setDistFunc( std::string distFunType, bool isSparse )
 {
-  if ( distFunType == "raw" )
+  useBitAlgn    = false;
+  useSparseAlgn = false;
+  distRows      = msa;
+  if ( !isCountMethod( distFunType ) &&
+       distFunType != "normProb" && distFunType != "logLike" )
   {
-    distFunction = &MsaDistance::calcRawDist;
+    std::string errStr = "Distance function type " + distFunType +
+      " is not supported\nSupported types are:\n  -- raw\n  -- shared\n" +
+      "  -- pDist\n  -- JC69\n  -- K2P\n  -- poisson\n  -- normProb\n" +
+      "  -- logLike";
+    Rcpp::stop( errStr );
   }
-  else if ( distFunType ==  "shared" )
+  if ( isSparse && !isCountMethod( distFunType ) )
+    Rcpp::stop( "Only the distances from the counts of the mismatches can " +
+      std::string( "be counted from the differences from the consensus" ) );
+  if ( isSparse && distFunType == "K2P" )
+    Rcpp::stop( "The transitions of the \"K2P\" distance cannot be " +
+      std::string( "counted from the differences from the consensus" ) );
+
+  if ( isCountMethod( distFunType ) )
   {
-    distFunction = &MsaDistance::calcSharedDist;
+    if ( distFunType == "raw" ) distModel = MODEL_RAW;
+    else if ( distFunType == "shared" || distFunType == "pDist" )
+      distModel = MODEL_SHARED;
+    else if ( distFunType == "JC69" ) distModel = MODEL_JC69;
+    else if ( distFunType == "K2P" ) distModel = MODEL_K2P;
+    else distModel = MODEL_POISSON;
+
+    // Encode the alignment once to count the mismatches of every pair
+    if ( isSparse )
+    {
+      sparseAlgn.encode( msa, algnLen );
+      useSparseAlgn = true;
+    }
+    else
+    {
+      bitAlgn.encode( msa, algnLen );
+      useBitAlgn = true;
+      if ( distModel == MODEL_K2P &&
+           bitAlgn.getAlphabet() != ALPHABET_DNA )
+        Rcpp::stop( "The \"K2P\" distance is only defined for nucleotide " +
+          std::string( "alignments" ) );
+    }
   }
   else if ( distFunType ==  "normProb" )
   {
-    distFunction = &MsaDistance::calcNormProbDist;
+    distModel = MODEL_SCORE;
 
     // Read in the alignment and calcualte the pairwise substitutions in they
     // alignment
-    algnSubCalc.updateSubMat( msa );
+    algnSubCalc.updateSubMat( msa, algnLen );
 
-    // Normalize the matirx to get the log liklihood
+    // Normalize the matirx to get the log liklihood. Only the mismatches
+    // are scored
     algnSubCalc.calcNormalizedProbs();
+    setScoreTable( true );
   }
-  else if ( distFunType ==  "logLike" )
+  else
   {
-    distFunction = &MsaDistance::calcBlosum;
+    distModel = MODEL_SCORE;
 
     // Read in the alignment and calcualte the pairwise substitutions in the
     // alignment
-    algnSubCalc.updateSubMat( msa );
+    algnSubCalc.updateSubMat( msa, algnLen );
 
     // Normalize the matirx to get the log liklihood
     algnSubCalc.calcLogLikelihoods();
+    setScoreTable( false );
   }
-  else
+}
+
+// Returns true if the distances of the method are calculated from the
+// counts of the mismatches
+bool MsaDistance::isCountMethod( const std::string &distFunType )
+{
+  return distFunType == "raw" || distFunType == "shared" ||
+    distFunType == "pDist" || distFunType == "JC69" ||
+    distFunType == "K2P" || distFunType == "poisson";
+}
+
+// Set the window of columns in the alignment to calculate the distances for
+void MsaDistance::setWindow( size_t start, size_t len )
+{
+  if ( start + len > algnLen )
+    Rcpp::stop( "The window is not inside of the alignment" );
+  winStart = start;
+  winLen   = len;
+}
+
+const std::size_t MsaDistance::BLOCK_SIZE;
+const std::size_t MsaDistance::CACHE_BYTES;
+const std::size_t MsaDistance::MIN_PARTITION_JOBS;
+
+// Calculate the distance between every pair of sequences in the window
+void MsaDistance::calcDistances( std::size_t firstSeq )
+{
+  // Split the lower triangle into tiles of blocks of sequences
+  std::size_t numSeqs = msa.size();
+  setTiles( firstSeq, numSeqs );
+
+  // Call tbb::parallel_for, the tiles will be executed on the availible
+  // number of threads
+  parallelFor( 0, tiles.size(), *this );
+
+  // Copy the lower triangle to the upper triangle of a full matrix
+  if ( !distOut.getIsDense() ) return;
+  tbb::parallel_for( std::size_t( 0 ), tiles.size(), [&] ( std::size_t t )
   {
-    std::string errStr = "Distance function type " + distFunType +
-      " is not supported\nSupported types are:\n  -- raw\n  -- shared\n" +
-      "  -- normProb\n  -- logLike";
-    Rcpp::stop( errStr );
+    std::size_t iStart = tiles[ t ].first;
+    std::size_t jStart = tiles[ t ].second;
+    std::size_t iEnd   = std::min( iStart + BLOCK_SIZE, numSeqs );
+    std::size_t jEnd   = std::min( jStart + BLOCK_SIZE, numSeqs );
+    for ( std::size_t i = iStart; i < iEnd; i++ )
+      for ( std::size_t j = jStart; j < jEnd && j < i; j++ )
+        distOut.mirror( i, j );
+  });
+}
+
+// Calculate the distances between the first "numColSeqs" sequences and
+// the remaining sequences
+void MsaDistance::calcCrossDistances( std::size_t numColSeqs )
+{
+  if ( seqIds.size() != msa.size() )
+    Rcpp::stop( "The index of every sequence in the output must be set" );
+
+  setTiles( numColSeqs, numColSeqs );
+  parallelFor( 0, tiles.size(), *this );
+}
+
+// Calculate the distance matrix of every partition of the alignment in a
+// single pass
+void MsaDistance::calcPartitionDists(
+  const std::vector< std::size_t > &partEnds, double *outDists
+  )
+{
+  std::size_t numSeqs  = msa.size();
+  std::size_t numParts = partEnds.size();
+  for ( std::size_t p = 0; p < numParts; p++ )
+  {
+    if ( partEnds[ p ] > algnLen || ( p && partEnds[ p ] < partEnds[ p - 1 ] ) )
+      Rcpp::stop( "The partitions must be in order and inside of the " +
+        std::string( "alignment" ) );
+  }
+  if ( !numParts || !numSeqs ) return;
+  setTiles( 0, numSeqs );
+
+  // Group the partitions into ranges with about the same number of
+  // positions, so there are enough jobs when there are few tiles
+  std::size_t numGroups = std::min( numParts,
+    ( MIN_PARTITION_JOBS + tiles.size() - 1 ) / tiles.size() );
+  std::vector< std::size_t > groupStarts( 1, 0 );
+  for ( std::size_t g = 1; g < numGroups; g++ )
+  {
+    std::size_t groupStart = std::upper_bound( partEnds.begin(),
+      partEnds.end(), g * partEnds.back() / numGroups ) - partEnds.begin();
+    if ( groupStart > groupStarts.back() && groupStart < numParts )
+      groupStarts.push_back( groupStart );
   }
+  groupStarts.push_back( numParts );
+  numGroups = groupStarts.size() - 1;
+
+  // Each job is a tile of pairs and a group of partitions
+  tbb::parallel_for( std::size_t( 0 ), tiles.size() * numGroups,
+    [&] ( std::size_t job )
+  {
+    std::size_t t = job / numGroups;
+    std::size_t g = job % numGroups;
+    calcPartitionTile( tiles[ t ].first, tiles[ t ].second, partEnds,
+      groupStarts[ g ], groupStarts[ g + 1 ], outDists );
+  });
+
+  // Copy the lower triangle of each matrix to the upper triangle
+  mirrorMats( outDists, numSeqs, numParts );
 }
 
-// Set the sequences contained in this alignment.
-void MsaDistance::setMsaSeqs( const std::vector< std::string > & msa )
+// Copy the lower triangle of each matrix to the upper triangle
+void MsaDistance::mirrorMats( double *mats, std::size_t numSeqs,
+  std::size_t numMats
+  )
 {
-  this->msa = msa;
+  std::size_t matSize = numSeqs * numSeqs;
+  tbb::parallel_for( std::size_t( 0 ), numMats, [&] ( std::size_t m )
+  {
+    double *mat = mats + m * matSize;
+    for ( std::size_t j = 0; j < numSeqs; j++ )
+    {
+      mat[ j + j * numSeqs ] = 0;
+      for ( std::size_t i = j + 1; i < numSeqs; i++ )
+        mat[ j + i * numSeqs ] = mat[ i + j * numSeqs ];
+    }
+  });
 }
 
-// Calculate the raw number of mutations between two sequences
-double MsaDistance::calcRawDist(
-  const std::string &ref, const std::string &qry
+const std::size_t MsaDistance::NUM_COUNT_MATS;
+const std::size_t MsaDistance::NUM_CODON_MATS;
+
+// Count the mismatches and the shared sites of every pair in a single pass
+void MsaDistance::calcCountMats( bool isCodons, double *outMats )
+{
+  if ( !useBitAlgn || distModel != MODEL_RAW )
+    Rcpp::stop( "The counts are only calculated with the \"raw\" distance" );
+  if ( isCodons && bitAlgn.getAlphabet() != ALPHABET_DNA )
+    Rcpp::stop( "The codon positions are only defined for nucleotide " +
+      std::string( "alignments" ) );
+  std::size_t numSeqs = msa.size();
+  if ( !numSeqs ) return;
+  setTiles( 0, numSeqs );
+
+  tbb::parallel_for( std::size_t( 0 ), tiles.size(), [&] ( std::size_t t )
+  {
+    calcCountTile( tiles[ t ].first, tiles[ t ].second, isCodons, outMats );
+  });
+  mirrorMats( outMats, numSeqs, isCodons ? NUM_CODON_MATS : NUM_COUNT_MATS );
+}
+
+// Count the mismatches and the shared sites of the pairs in a tile. The
+// counts at each codon position are summed for the counts of the window
+void MsaDistance::calcCountTile( std::size_t iStart, std::size_t jStart,
+  bool isCodons, double *outMats
   )
 {
-  // Initialize a counter for the number of mutations between two sequences
-  double numMutations = 0;
+  std::size_t numSeqs = msa.size();
+  std::size_t matSize = numSeqs * numSeqs;
+  std::size_t iEnd    = std::min( iStart + BLOCK_SIZE, numSeqs );
+  std::size_t jEnd    = std::min( jStart + BLOCK_SIZE, colEnd );
+
+  // The counts of each pair at each codon position are accumulated over
+  // the chunks of positions. Without the codon positions only the first
+  // entry of each pair is used
+  uint64_t mismatches[ BLOCK_SIZE * BLOCK_SIZE ][ 3 ] = { { 0 } };
+  uint64_t sites[ BLOCK_SIZE * BLOCK_SIZE ][ 3 ]      = { { 0 } };
+  std::size_t chunkLen = getChunkLen();
+  std::size_t winEnd   = winStart + winLen;
+  for ( std::size_t cStart = winStart; cStart < winEnd; )
+  {
+    std::size_t cEnd = std::min( ( cStart / 64 * 64 ) + chunkLen, winEnd );
+    for ( std::size_t j = jStart; j < jEnd; j++ )
+    {
+      for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+      {
+        std::size_t idx = ( j - jStart ) * BLOCK_SIZE + ( i - iStart );
+        uint64_t chunkMismatches[ 3 ] = { 0 };
+        uint64_t chunkSites[ 3 ]      = { 0 };
+        if ( isCodons )
+          bitAlgn.countCodonDiffs( i, j, cStart, cEnd - cStart,
+            chunkMismatches, chunkSites );
+        else
+          bitAlgn.countDiffs( i, j, cStart, cEnd - cStart,
+            chunkMismatches[ 0 ], chunkSites[ 0 ] );
+        for ( std::size_t c = 0; c < 3; c++ )
+        {
+          mismatches[ idx ][ c ] += chunkMismatches[ c ];
+          sites[ idx ][ c ]      += chunkSites[ c ];
+        }
+      }
+    }
+    cStart = cEnd;
+  }
 
-  // For each base in the two sequence, see if there is NOT a match at
-  // the ith position of of the alignment and there is not an aligned,
-  // base at that position increment the number of mutations.
-  for ( unsigned int i = 0; i < ref.size(); i++ )
+  for ( std::size_t j = jStart; j < jEnd; j++ )
   {
-    // If this position in the reference is not the same as the
-    // query..
-    if ( ref[i] != qry[i] )
+    for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
     {
-      // And neither sequence has a gap at this position, increment
-      // the counter for the numer of numations
-      if ( ref[i] != '-' && qry[i] != '-' && ref[i] != 'N' &&  qry[i] != 'N' )
+      std::size_t idx    = ( j - jStart ) * BLOCK_SIZE + ( i - iStart );
+      std::size_t matIdx = i + j * numSeqs;
+      const uint64_t *pairMismatches = mismatches[ idx ];
+      const uint64_t *pairSites      = sites[ idx ];
+      outMats[ matIdx ] = pairMismatches[ 0 ] + pairMismatches[ 1 ] +
+        pairMismatches[ 2 ];
+      outMats[ matSize + matIdx ] = pairSites[ 0 ] + pairSites[ 1 ] +
+        pairSites[ 2 ];
+      if ( !isCodons ) continue;
+      for ( std::size_t c = 0; c < 3; c++ )
       {
-        numMutations += 1;
+        outMats[ ( 2 + 2 * c ) * matSize + matIdx ] = pairMismatches[ c ];
+        outMats[ ( 3 + 2 * c ) * matSize + matIdx ] = pairSites[ c ];
       }
     }
   }
-  return numMutations;
 }
 
-// Function call operator that work from the range specified by begin and end
-void MsaDistance::operator()(std::size_t begin, std::size_t end)
+// Calculate the distances of the pairs in a tile for a range of partitions
+void MsaDistance::calcPartitionTile( std::size_t iStart, std::size_t jStart,
+  const std::vector< std::size_t > &partEnds, std::size_t partBegin,
+  std::size_t partEnd, double *outDists
+  )
 {
-  // Initialize the value that stores the distances
-  double distVal;
-
-  // FInd the pairwise differences for each sequence
-  for ( std::size_t i = begin; i < end; i++ )
+  switch ( distModel )
   {
-    for ( std::size_t j = 0; j < i; j++ )
+    case MODEL_RAW:
+      calcPartitionCounts< RawModel >(
+        iStart, jStart, partEnds, partBegin, partEnd, outDists );
+      break;
+    case MODEL_SHARED:
+      calcPartitionCounts< SharedModel >(
+        iStart, jStart, partEnds, partBegin, partEnd, outDists );
+      break;
+    case MODEL_JC69:
+      calcPartitionCounts< Jc69Model >(
+        iStart, jStart, partEnds, partBegin, partEnd, outDists );
+      break;
+    case MODEL_K2P:
+      calcPartitionCounts< K2pModel >(
+        iStart, jStart, partEnds, partBegin, partEnd, outDists );
+      break;
+    case MODEL_POISSON:
+      calcPartitionCounts< PoissonModel >(
+        iStart, jStart, partEnds, partBegin, partEnd, outDists );
+      break;
+    case MODEL_SCORE:
     {
-      // Value to store the count of mismatches between the two sequences
-      if ( j == i ) distVal = 0;
-      else distVal = ( this->*distFunction )( msa[ i ], msa[ j ] );
-
-      // Assign the position in the distance matrix to the number
-      // of mutations
-      distMat( i, j ) = distVal;
-      distMat( j, i ) = distVal;
+      std::size_t numSeqs = msa.size();
+      std::size_t iEnd    = std::min( iStart + BLOCK_SIZE, numSeqs );
+      std::size_t jEnd    = std::min( jStart + BLOCK_SIZE, colEnd );
+      for ( std::size_t p = partBegin; p < partEnd; p++ )
+      {
+        std::size_t pStart = p ? partEnds[ p - 1 ] : 0;
+        double     *mat    = outDists + p * numSeqs * numSeqs;
+        for ( std::size_t j = jStart; j < jEnd; j++ )
+          for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+            mat[ i + j * numSeqs ] = calcScoreDist( distRows[ i ] + pStart,
+              distRows[ j ] + pStart, partEnds[ p ] - pStart );
+      }
+      break;
     }
   }
 }
 
-// Returns the number of mutations normalized to the number of shared
-// sites (excluding gap potitions)
-double MsaDistance::calcSharedDist(
-  const std::string &ref, const std::string &qry
+// Calculate the distances of the pairs in a tile for a range of partitions
+// from the counts of the differences
+template< class Model >
+void MsaDistance::calcPartitionCounts( std::size_t iStart,
+  std::size_t jStart, const std::vector< std::size_t > &partEnds,
+  std::size_t partBegin, std::size_t partEnd, double *outDists
   )
 {
-  // Initialize a counters for the number of mutations between two sequences
-  // and a counter for the number of sites that the two sequences share
-  double numMutations = 0;
-  double numSites     = 0;
+  std::size_t numSeqs = msa.size();
+  std::size_t iEnd    = std::min( iStart + BLOCK_SIZE, numSeqs );
+  std::size_t jEnd    = std::min( jStart + BLOCK_SIZE, colEnd );
+
+  // Positions in a chunk so the bitplanes of both blocks fit in the cache
+  std::size_t chunkLen = getChunkLen();
 
-  // For each base in the two sequence, see if there is NOT a match at
-  // the ith position of of the alignment and there is not an aligned,
-  // base at that position increment the number of mutations.
-  for ( unsigned int i = 0; i < ref.size(); i++ )
+  // The partitions are in order, so the positions are read once
+  for ( std::size_t p = partBegin; p < partEnd; p++ )
   {
-    // If this position in the reference is not the same as the
-    // query..
-    if (  ref[i] != '-' && qry[i] != '-' && ref[i] != 'N' &&  qry[i] != 'N' )
+    std::size_t pStart = p ? partEnds[ p - 1 ] : 0;
+    std::size_t pEnd   = partEnds[ p ];
+    double     *mat    = outDists + p * numSeqs * numSeqs;
+
+    // Accumulate the counts of the partition over the chunks
+    DiffCounts counts[ BLOCK_SIZE * BLOCK_SIZE ];
+    for ( std::size_t cStart = pStart; cStart < pEnd; )
     {
-      // And neither sequence has a gap at this position, increment
-      // the counter for the numer of numations
-      if ( ref[i] != qry[i] )
+      std::size_t cEnd = useBitAlgn ?
+        std::min( ( cStart / 64 * 64 ) + chunkLen, pEnd ) : pEnd;
+      for ( std::size_t j = jStart; j < jEnd; j++ )
       {
-        numMutations += 1.0;
+        for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+        {
+          std::size_t idx = ( j - jStart ) * BLOCK_SIZE + ( i - iStart );
+          counts[ idx ] += countPair< Model >( i, j, cStart, cEnd - cStart );
+        }
       }
-      numSites += 1.0;
+      cStart = cEnd;
     }
-  }
-  // If there are no shared sites between these sequences (which will happen
-  // if the alignment is only gap positions) then return zero
-  if ( numSites == 0 ) return 0;
 
-  // Return the fraction of mutations per non-gap position
-  return numMutations / numSites;
+    for ( std::size_t j = jStart; j < jEnd; j++ )
+    {
+      for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+      {
+        std::size_t idx = ( j - jStart ) * BLOCK_SIZE + ( i - iStart );
+        mat[ i + j * numSeqs ] = Model::calcDist( counts[ idx ] );
+      }
+    }
+  }
 }
 
-double MsaDistance::calcNormProbDist(
-  const std::string &ref, const std::string &qry
+// Calculate the distances between every pair of sequences in sliding
+// windows
+void MsaDistance::calcSlidingDists( const std::vector< std::size_t > &winStarts,
+  std::size_t winLen, double *outDists
   )
 {
-  // Initialize a value to store the calulated distance between the two
-  // sequences
-  double seqDist = 0;
+  std::size_t numSeqs  = msa.size();
+  std::size_t numPairs = DistOutput::getCondensedSize( numSeqs );
+  for ( std::size_t w = 0; w < winStarts.size(); w++ )
+  {
+    if ( winStarts[ w ] + winLen > algnLen ||
+         ( w && winStarts[ w ] < winStarts[ w - 1 ] ) ||
+         ( slideEnd && winStarts[ w ] < slideStart ) )
+      Rcpp::stop( "The windows must be in order and inside of the alignment" );
+  }
+  if ( slideEnd == 0 )
+  {
+    slideCounts.assign( numPairs, DiffCounts() );
+    slideSums.assign( numPairs, 0 );
+  }
+  setTiles( 0, numSeqs );
 
-  // For each base in the two sequence, see if there is NOT a match at
-  // the ith position of of the alignment and there is not an aligned,
-  // base at that position increment the number of mutations.
-  for ( unsigned int i = 0; i < ref.size(); i++ )
+  // Each tile slides its pairs through every window
+  tbb::parallel_for( std::size_t( 0 ), tiles.size(), [&] ( std::size_t t )
   {
-    // If this position in the reference is not the same as the
-    // query..
-    if (  ref[i] != '-' && qry[i] != '-' && ref[i] != 'N' &&  qry[i] != 'N' )
+    switch ( distModel )
     {
-      // And neither sequence has a gap at this position, increment
-      // the counter for the numer of numations
-      if ( ref[i] != qry[i] )
+      case MODEL_RAW:
+        slideTile< RawModel >( t, winStarts, winLen, outDists );
+        break;
+      case MODEL_SHARED:
+        slideTile< SharedModel >( t, winStarts, winLen, outDists );
+        break;
+      case MODEL_JC69:
+        slideTile< Jc69Model >( t, winStarts, winLen, outDists );
+        break;
+      case MODEL_K2P:
+        slideTile< K2pModel >( t, winStarts, winLen, outDists );
+        break;
+      case MODEL_POISSON:
+        slideTile< PoissonModel >( t, winStarts, winLen, outDists );
+        break;
+      case MODEL_SCORE:
+        slideScoreTile( t, winStarts, winLen, outDists );
+        break;
+    }
+  });
+
+  if ( !winStarts.empty() )
+  {
+    slideStart = winStarts.back();
+    slideEnd   = winStarts.back() + winLen;
+  }
+}
+
+// Slide the pairs of a tile through the windows
+template< class Model >
+void MsaDistance::slideTile( std::size_t t,
+  const std::vector< std::size_t > &winStarts, std::size_t winLen,
+  double *outDists
+  )
+{
+  std::size_t numSeqs  = msa.size();
+  std::size_t numPairs = DistOutput::getCondensedSize( numSeqs );
+  std::size_t iStart   = tiles[ t ].first;
+  std::size_t jStart   = tiles[ t ].second;
+  std::size_t iEnd     = std::min( iStart + BLOCK_SIZE, numSeqs );
+  std::size_t jEnd     = std::min( jStart + BLOCK_SIZE, numSeqs );
+  std::size_t prevStart = slideStart;
+  std::size_t prevEnd   = slideEnd;
+  for ( std::size_t w = 0; w < winStarts.size(); w++ )
+  {
+    // Add the positions that enter the window and remove the positions
+    // that leave it. A window that does not overlap the previous window
+    // is counted from the start
+    std::size_t start    = winStarts[ w ];
+    std::size_t end      = start + winLen;
+    bool        isReset  = prevEnd == 0 || start >= prevEnd;
+    std::size_t addStart = isReset ? start : prevEnd;
+    std::size_t subLen   = isReset ? 0 : start - prevStart;
+    double     *winDists = outDists + w * numPairs;
+    for ( std::size_t j = jStart; j < jEnd; j++ )
+    {
+      for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
       {
-        seqDist += algnSubCalc.getSubPr( ref[i], qry[i] );
+        std::size_t idx = DistOutput::getCondensedIdx( numSeqs, i, j );
+        if ( isReset ) slideCounts[ idx ] = DiffCounts();
+        slideCounts[ idx ] +=
+          countPair< Model >( i, j, addStart, end - addStart );
+        slideCounts[ idx ] -= countPair< Model >( i, j, prevStart, subLen );
+        winDists[ idx ] = Model::calcDist( slideCounts[ idx ] );
       }
     }
+    prevStart = start;
+    prevEnd   = end;
   }
-  return seqDist;
 }
 
-double MsaDistance::calcBlosum(
-  const std::string &ref, const std::string &qry
+// Slide the pairs of a tile through the windows, summing the scores of
+// the substitutions
+void MsaDistance::slideScoreTile( std::size_t t,
+  const std::vector< std::size_t > &winStarts, std::size_t winLen,
+  double *outDists
   )
 {
-  // Initialize a value to store the calulated distance between the two
-  // sequences
-  double seqDist = 0;
+  std::size_t numSeqs  = msa.size();
+  std::size_t numPairs = DistOutput::getCondensedSize( numSeqs );
+  std::size_t iStart   = tiles[ t ].first;
+  std::size_t jStart   = tiles[ t ].second;
+  std::size_t iEnd     = std::min( iStart + BLOCK_SIZE, numSeqs );
+  std::size_t jEnd     = std::min( jStart + BLOCK_SIZE, numSeqs );
+  std::size_t prevStart   = slideStart;
+  std::size_t prevEnd     = slideEnd;
+  std::size_t anchorStart = 0;
+  for ( std::size_t w = 0; w < winStarts.size(); w++ )
+  {
+    // Add the positions that enter the window and remove the positions
+    // that leave it. The running sums of doubles lose precision with each
+    // addition and subtraction, so the window is summed from the start at
+    // the first window of each call and once the window has moved by its
+    // length since it was last summed from the start. This at most doubles
+    // the positions that are read
+    std::size_t start    = winStarts[ w ];
+    std::size_t end      = start + winLen;
+    bool        isReset  = w == 0 || start >= prevEnd ||
+      start - anchorStart >= winLen;
+    if ( isReset ) anchorStart = start;
+    std::size_t addStart = isReset ? start : prevEnd;
+    std::size_t subLen   = isReset ? 0 : start - prevStart;
+    double     *winDists = outDists + w * numPairs;
+    for ( std::size_t j = jStart; j < jEnd; j++ )
+    {
+      for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+      {
+        std::size_t idx = DistOutput::getCondensedIdx( numSeqs, i, j );
+        if ( isReset ) slideSums[ idx ] = 0;
+        slideSums[ idx ] += calcScoreDist( distRows[ i ] + addStart,
+          distRows[ j ] + addStart, end - addStart );
+        slideSums[ idx ] -= calcScoreDist( distRows[ i ] + prevStart,
+          distRows[ j ] + prevStart, subLen );
+        winDists[ idx ] = slideSums[ idx ];
+      }
+    }
+    prevStart = start;
+    prevEnd   = end;
+  }
+}
+
+// Split the pairs of sequences into tiles
+void MsaDistance::setTiles( std::size_t rowStart, std::size_t colEnd )
+{
+  // The tiles on the diagonal only have the pairs below the diagonal
+  this->colEnd = colEnd;
+  tiles.clear();
+  for ( std::size_t i = rowStart; i < msa.size(); i += BLOCK_SIZE )
+    for ( std::size_t j = 0; j < colEnd && j < i + BLOCK_SIZE; j += BLOCK_SIZE )
+      tiles.push_back( std::make_pair( i, j ) );
+}
+
+// Function call operator that work from the range specified by begin and end.
+// The kernel of the distance model is chosen once for the range of tiles
+void MsaDistance::operator()( std::size_t begin, std::size_t end )
+{
+  switch ( distModel )
+  {
+    case MODEL_RAW:     calcTiles< RawModel >( begin, end );     break;
+    case MODEL_SHARED:  calcTiles< SharedModel >( begin, end );  break;
+    case MODEL_JC69:    calcTiles< Jc69Model >( begin, end );    break;
+    case MODEL_K2P:     calcTiles< K2pModel >( begin, end );     break;
+    case MODEL_POISSON: calcTiles< PoissonModel >( begin, end ); break;
+    case MODEL_SCORE:
+      for ( std::size_t t = begin; t < end; t++ )
+        calcScoreTile( tiles[ t ].first, tiles[ t ].second );
+      break;
+  }
+}
 
-  // For each base in the two sequence, see if there is NOT a match at
-  // the ith position of of the alignment and there is not an aligned,
-  // base at that position increment the number of mutations.
-  for ( unsigned int i = 0; i < ref.size(); i++ )
+// Calculate the distances of a range of tiles from the counts of the
+// differences
+template< class Model >
+void MsaDistance::calcTiles( std::size_t begin, std::size_t end )
+{
+  for ( std::size_t t = begin; t < end; t++ )
   {
-    // If this position in the reference is not the same as the
-    // query..
-    if (  ref[i] != '-' && qry[i] != '-' && ref[i] != 'N' &&  qry[i] != 'N' )
+    if ( useBitAlgn )
+      calcBitTile< Model >( tiles[ t ].first, tiles[ t ].second );
+    else calcSparseTile< Model >( tiles[ t ].first, tiles[ t ].second );
+  }
+}
+
+// Write the distance between sequences i and j
+void MsaDistance::setDist( std::size_t i, std::size_t j, double dist )
+{
+  if ( seqIds.empty() ) distOut.set( i, j, dist );
+  else distOut.set( seqIds[ i ], seqIds[ j ], dist );
+}
+
+// Calculate the distances between the sequences in a tile from the scores
+// of the substitutions
+void MsaDistance::calcScoreTile( std::size_t iStart, std::size_t jStart )
+{
+  std::size_t iEnd = std::min( iStart + BLOCK_SIZE, msa.size() );
+  std::size_t jEnd = std::min( jStart + BLOCK_SIZE, colEnd );
+
+  // The matrix is column-major, so the rows are the inner loop
+  for ( std::size_t j = jStart; j < jEnd; j++ )
+  {
+    for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
     {
-      seqDist += algnSubCalc.getSubPr( ref[i], qry[i] );
+      setDist( i, j, calcScoreDist(
+        distRows[ i ] + winStart, distRows[ j ] + winStart, winLen ) );
     }
   }
-  return seqDist;
+}
+
+// Return the number of positions in a chunk so the bitplanes of both
+// blocks of a tile fit in the cache. Chunks are a multiple of the 64 bit
+// words
+std::size_t MsaDistance::getChunkLen() const
+{
+  if ( !useBitAlgn ) return 64;
+  std::size_t chunkLen = CACHE_BYTES * 8 /
+    ( 2 * BLOCK_SIZE * bitAlgn.getBitsPerSite() ) / 64 * 64;
+  return std::max( chunkLen, std::size_t( 64 ) );
+}
+
+// Calculate the distances in a tile from the bitplanes
+template< class Model >
+void MsaDistance::calcBitTile( std::size_t iStart, std::size_t jStart )
+{
+  std::size_t iEnd = std::min( iStart + BLOCK_SIZE, msa.size() );
+  std::size_t jEnd = std::min( jStart + BLOCK_SIZE, colEnd );
+
+  // Accumulate the counts of every pair in the tile over the chunks
+  DiffCounts  counts[ BLOCK_SIZE * BLOCK_SIZE ];
+  std::size_t chunkLen = getChunkLen();
+  std::size_t winEnd   = winStart + winLen;
+  for ( std::size_t cStart = winStart; cStart < winEnd; )
+  {
+    std::size_t cEnd = std::min( ( cStart / 64 * 64 ) + chunkLen, winEnd );
+    for ( std::size_t j = jStart; j < jEnd; j++ )
+    {
+      for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+      {
+        std::size_t idx = ( j - jStart ) * BLOCK_SIZE + ( i - iStart );
+        counts[ idx ] += countPair< Model >( i, j, cStart, cEnd - cStart );
+      }
+    }
+    cStart = cEnd;
+  }
+
+  for ( std::size_t j = jStart; j < jEnd; j++ )
+  {
+    for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+    {
+      std::size_t idx = ( j - jStart ) * BLOCK_SIZE + ( i - iStart );
+      setDist( i, j, Model::calcDist( counts[ idx ] ) );
+    }
+  }
+}
+
+// Calculate the distances in a tile from the differences from the consensus
+template< class Model >
+void MsaDistance::calcSparseTile( std::size_t iStart, std::size_t jStart )
+{
+  std::size_t iEnd = std::min( iStart + BLOCK_SIZE, msa.size() );
+  std::size_t jEnd = std::min( jStart + BLOCK_SIZE, colEnd );
+
+  for ( std::size_t j = jStart; j < jEnd; j++ )
+  {
+    for ( std::size_t i = std::max( iStart, j + 1 ); i < iEnd; i++ )
+    {
+      setDist( i, j, Model::calcDist(
+        countPair< Model >( i, j, winStart, winLen ) ) );
+    }
+  }
+}
+
+// Count the differences between two sequences in a window
+template< class Model >
+inline DiffCounts MsaDistance::countPair( std::size_t i, std::size_t j,
+  std::size_t start, std::size_t len
+  ) const
+{
+  DiffCounts counts;
+  if ( useSparseAlgn )
+    sparseAlgn.countDiffs(
+      i, j, start, len, counts.mismatches, counts.sites );
+  else if ( Model::NEEDS_TRANSITIONS )
+    bitAlgn.countDiffs( i, j, start, len, counts.mismatches, counts.sites,
+      counts.transitions );
+  else
+    bitAlgn.countDiffs( i, j, start, len, counts.mismatches, counts.sites );
+  return counts;
+}
+
+// Encode the alignment and set the table of the scores of each pair of
+// codes
+void MsaDistance::setScoreTable( bool skipMatches )
+{
+  scoreTable = algnSubCalc.getScoreTable( skipMatches );
+
+  // Encode the rows in parallel and point the distance function to the
+  // encoded rows
+  scoreCodes.resize( msa.size() * algnLen );
+  distRows.resize( msa.size() );
+  tbb::parallel_for( size_t( 0 ), msa.size(), [&] ( size_t i )
+  {
+    algnSubCalc.encodeSeq( msa[ i ], algnLen, scoreCodes.data() + i * algnLen );
+    distRows[ i ] = scoreCodes.data() + i * algnLen;
+  });
+}
+
+double MsaDistance::calcScoreDist(
+  const char *ref, const char *qry, size_t len
+  )
+{
+  // Sum the score of the pair of codes at each position. The codes that
+  // are not scored have a score of zero, so the loop has no branches. Four
+  // partial sums are kept so the additions do not wait on each other
+  const double        *table = scoreTable.data();
+  const unsigned char *rPos  = (const unsigned char *) ref;
+  const unsigned char *qPos  = (const unsigned char *) qry;
+  const int            width = AlgnSubCalc::NUM_SCORE_CODES;
+  double sums[ 4 ] = { 0, 0, 0, 0 };
+  size_t i = 0;
+  for ( ; i + 4 <= len; i += 4 )
+  {
+    sums[ 0 ] += table[ rPos[ i ] * width + qPos[ i ] ];
+    sums[ 1 ] += table[ rPos[ i + 1 ] * width + qPos[ i + 1 ] ];
+    sums[ 2 ] += table[ rPos[ i + 2 ] * width + qPos[ i + 2 ] ];
+    sums[ 3 ] += table[ rPos[ i + 3 ] * width + qPos[ i + 3 ] ];
+  }
+  for ( ; i < len; i++ ) sums[ 0 ] += table[ rPos[ i ] * width + qPos[ i ] ];
+  return ( sums[ 0 ] + sums[ 1 ] ) + ( sums[ 2 ] + sums[ 3 ] );
 }
 
 // -----------------------------------------------------------------------------
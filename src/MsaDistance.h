@@ -3,6 +3,10 @@
 #include <RcppParallel.h>
 #include <Rcpp.h>
 #include "AlgnSubCalc.h"
+#include "BitAlgn.h"
+#include "SparseAlgn.h"
+#include "DistOutput.h"
+#include "DistModels.h"
 using namespace RcppParallel;
 
 // -----------------------------------------------------------------------------
@@ -14,68 +18,278 @@ using namespace RcppParallel;
 // MSA distances. For each pair of sequences in the alignment, disttance
 // is calcuated as the number of mutations between the two sequences.
 // The struct is a functor used by tbb via RcppParallel. The name of the
-// distancefunction to be used is passed as argument into the ctor and a
-// function pointer is used in the call operator to specify the distance
-// function to be used.
+// distance function sets the model of the distance, and the tile kernels
+// are templates on the model type from DistModels.h, so the model is chosen
+// once for each range of tiles and the distance of each pair is inlined
+// into the kernel. The functor reads the sequences through pointers to
+// the rows of the alignment, and a window of columns can be set so the
+// distances of a partition are calculated without copying the alignment.
+// The "raw", "shared", "JC69", "K2P" and "poisson" distances only depend on
+// the mismatches, shared sites and transitions, so they are counted from
+// the bitplanes of the alignment instead, or from the differences of each
+// sequence from the consensus when the sequences are nearly identical. The
+// "normProb" and "logLike" distances are sums over the substitution matrix,
+// so the alignment is encoded with the index of each amino acid and the
+// scores are read from a flat table of the matrix.
+// The lower triangle of the matrix is split into tiles of pairs between two
+// blocks of sequences, and each range of the parallel for is a range of
+// tiles. The tiles are all the same size, so the work is balanced across
+// the threads. Within a tile the positions are processed in chunks that
+// keep the bitplanes of both blocks in the L2 cache. Each distance is
+// written once to the lower triangle of the output. When the output is a
+// full matrix, the lower triangle is copied to the upper triangle after
+// every tile is done. The distances between two blocks of sequences of a
+// larger alignment can also be calculated, with the global index of each
+// sequence used to write to the output.
+// The mismatches and shared sites of every pair, and of each codon
+// position, can also be written to separate matrices from the same pass
+// over the bitplanes, so the counts are not calculated once per metric.
 // -----------------------------------------------------------------------------
 
 #ifndef _MSA_DISTANCE_
 #define _MSA_DISTANCE_
 struct MsaDistance : public Worker
 {
-  // Ctor: Initialize from Rcpp input and output matrixes (the RMatrix class
-  // can be automatically converted to from the Rcpp matrix type). Additionally
-  // The integer indicating the type of function to sue
-  MsaDistance(
-    const std::vector<std::string> &msa, Rcpp::NumericMatrix distMat):
-    msa(msa), distMat(distMat)
+  // Ctor: Initialize from pointers to the rows of the alignment and the
+  // output the distances are written to. The window is initialized to the
+  // whole alignment
+  MsaDistance( const std::vector< const char * > &msa, size_t algnLen,
+    const DistOutput &distOut ):
+    msa( msa ), distRows( msa ), algnLen( algnLen ), winStart( 0 ),
+    winLen( algnLen ), distOut( distOut )
   { ; }
 
-  // Input multipe sequence alignment to calculate distance from
-  std::vector< std::string > msa;
+  // Ctor: Initialize from pointers to the rows of the alignment and the
+  // full output matrix
+  MsaDistance( const std::vector< const char * > &msa, size_t algnLen,
+    Rcpp::NumericMatrix distMat ):
+    MsaDistance( msa, algnLen, DistOutput( distMat ) )
+  { ; }
+
+  // Pointers to the rows of the multipe sequence alignment to calculate
+  // distance from
+  std::vector< const char * > msa;
+
+  // Pointers to the rows the distance function reads. These are the rows
+  // of the alignment, or the rows of the encoded alignment when the
+  // distances are scored from the substitution matrix
+  std::vector< const char * > distRows;
 
-  // Output matrix to write distances to
-  RMatrix< double > distMat;
+  // Length of the alignment
+  size_t algnLen;
+
+  // Start and length of the window of columns the distances are
+  // calculated for
+  size_t winStart;
+  size_t winLen;
+
+  // Output to write distances to
+  DistOutput distOut;
 
   // Object the calculates the substitution matrix between amino acids or
   // nucleotides in the alignment
   AlgnSubCalc algnSubCalc;
 
-  // Function call operator that work from the range specified by begin and
-  // end
+  // The alignment encoded as bitplanes
+  BitAlgn bitAlgn;
+
+  // Bool indicating that the distances are counted from the bitplanes
+  bool useBitAlgn = false;
+
+  // The alignment encoded as the differences from the consensus
+  SparseAlgn sparseAlgn;
+
+  // Bool indicating that the distances are counted from the differences
+  // from the consensus
+  bool useSparseAlgn = false;
+
+  // The model of the distance between two sequences
+  DistModel distModel = MODEL_RAW;
+
+  // The alignment encoded with the index of each amino acid, and the flat
+  // table of the score of each pair of codes, when the distances are
+  // summed from the substitution matrix
+  std::vector< char >   scoreCodes;
+  std::vector< double > scoreTable;
+
+  // Number of sequences in a block of a tile
+  static const std::size_t BLOCK_SIZE = 32;
+
+  // Size of the cache the bitplanes of a tile are sized for
+  static const std::size_t CACHE_BYTES = 1 << 18;
+
+  // Minimum number of tiles and groups of partitions calculated in
+  // parallel when the distances of the partitions are calculated
+  static const std::size_t MIN_PARTITION_JOBS = 256;
+
+  // The first row and column of each tile in the lower triangle
+  std::vector< std::pair< std::size_t, std::size_t > > tiles;
+
+  // End of the columns of the tiles
+  std::size_t colEnd = 0;
+
+  // Index of each sequence in the output. Empty if the sequences are
+  // written to the output in order
+  std::vector< std::size_t > seqIds;
+
+  // Running counts of the differences, or the running sum of the scores,
+  // of each pair in the last sliding window
+  std::vector< DiffCounts > slideCounts;
+  std::vector< double >     slideSums;
+
+  // Start and end of the last sliding window. The end is zero before the
+  // first window
+  std::size_t slideStart = 0;
+  std::size_t slideEnd   = 0;
+
+  // Calculate the distance between every pair of sequences in the window
+  // and write them to the distance matrix. If "firstSeq" is not zero, only
+  // the pairs with a sequence at or after "firstSeq" are calculated, so
+  // the distances of sequences added to an alignment are calculated
+  // without the pairs of the sequences that were already in the alignment
+  void calcDistances( std::size_t firstSeq = 0 );
+
+  // Calculate the distances between the first "numColSeqs" sequences and
+  // the remaining sequences. Each sequence is written to the output at
+  // its index in "seqIds", and the remaining sequences must have a larger
+  // index than the first sequences
+  void calcCrossDistances( std::size_t numColSeqs );
+
+  // Calculate the distance matrix of every partition of the alignment in a
+  // single pass. The partitions are contiguous from the start of the
+  // alignment and "partEnds" is the end of each partition. Tiles of pairs
+  // and groups of partitions are calculated in parallel, and the full
+  // matrices are written to the column-major array "outDists" of numSeqs x
+  // numSeqs x partitions
+  void calcPartitionDists( const std::vector< std::size_t > &partEnds,
+    double *outDists );
+
+  // Calculate the distances of the pairs in a tile for the partitions from
+  // "partBegin" to "partEnd". The positions of each partition are read
+  // once for all of the pairs in the tile
+  void calcPartitionTile( std::size_t iStart, std::size_t jStart,
+    const std::vector< std::size_t > &partEnds, std::size_t partBegin,
+    std::size_t partEnd, double *outDists );
+
+  // Calculate the distances of the partitions in a tile from the counts of
+  // the differences with the distance model
+  template< class Model >
+  void calcPartitionCounts( std::size_t iStart, std::size_t jStart,
+    const std::vector< std::size_t > &partEnds, std::size_t partBegin,
+    std::size_t partEnd, double *outDists );
+
+  // Count the mismatches and the shared sites of every pair of sequences in
+  // the window in a single pass over the bitplanes, and write them to the
+  // column-major array "outMats" of numSeqs x numSeqs x numMats. The first
+  // two matrices are the mismatches and the shared sites. If "isCodons" is
+  // true they are followed by the mismatches and shared sites at codon
+  // positions 1, 2 and 3, where alignment position p is at codon position
+  // p % 3 + 1. The distance function must be set to "raw"
+  void calcCountMats( bool isCodons, double *outMats );
+
+  // Count the mismatches and the shared sites of the pairs in a tile and
+  // write them to each of the matrices
+  void calcCountTile( std::size_t iStart, std::size_t jStart, bool isCodons,
+    double *outMats );
+
+  // Number of matrices of the counts, without and with the codon positions
+  static const std::size_t NUM_COUNT_MATS = 2;
+  static const std::size_t NUM_CODON_MATS = 8;
+
+  // Copy the lower triangle of each of the column-major numSeqs x numSeqs
+  // matrices to the upper triangle and set the diagonal to zero
+  static void mirrorMats( double *mats, std::size_t numSeqs,
+    std::size_t numMats );
+
+  // Calculate the distances between every pair of sequences in the windows
+  // of "winLen" positions starting at each of "winStarts", which must be
+  // increasing. The running counts of each pair are kept from the previous
+  // window, including the last window of the previous call, so only the
+  // positions that enter and leave the window are read. The distances of
+  // window w are written to the condensed lower triangle at
+  // outDists + w * numPairs
+  void calcSlidingDists( const std::vector< std::size_t > &winStarts,
+    std::size_t winLen, double *outDists );
+
+  // Slide the pairs of tile t through the windows with the distance model,
+  // or summing the scores of the substitutions. The sums of the scores are
+  // periodically recalculated from the start of a window
+  template< class Model >
+  void slideTile( std::size_t t, const std::vector< std::size_t > &winStarts,
+    std::size_t winLen, double *outDists );
+  void slideScoreTile( std::size_t t,
+    const std::vector< std::size_t > &winStarts, std::size_t winLen,
+    double *outDists );
+
+  // Split the pairs of sequences into tiles. The rows of the tiles start at
+  // "rowStart" and the columns end at "colEnd"
+  void setTiles( std::size_t rowStart, std::size_t colEnd );
+
+  // Function call operator that work from the range of tiles specified by
+  // begin and end
   void operator()( std::size_t begin, std::size_t end );
 
-  // Set the function pointer to the type specified by the input
-  // argument "distFunType"
-  void setDistFunc( std::string distFunType );
+  // Calculate the distances of a range of tiles from the counts of the
+  // differences with the distance model
+  template< class Model >
+  void calcTiles( std::size_t begin, std::size_t end );
 
-  // Set the sequences contained in this alignment.
-  void setMsaSeqs( const std::vector< std::string > & msa );
+  // Calculate the distances between the sequences in a tile from the
+  // scores of the substitutions
+  void calcScoreTile( std::size_t iStart, std::size_t jStart );
 
-  // This function cacluates the subsiion probabilities between sequences
-  // in the alignmet
-  void calcSubProbabilities();
+  // Calculate the distances in a tile from the bitplanes. The counts are
+  // accumulated one chunk of positions at a time
+  template< class Model >
+  void calcBitTile( std::size_t iStart, std::size_t jStart );
+
+  // Calculate the distances in a tile from the differences from the
+  // consensus
+  template< class Model >
+  void calcSparseTile( std::size_t iStart, std::size_t jStart );
+
+  // Count the differences between sequences i and j in the window starting
+  // at "start" of length "len". The transitions are only counted if the
+  // model needs them
+  template< class Model >
+  inline DiffCounts countPair( std::size_t i, std::size_t j,
+    std::size_t start, std::size_t len ) const;
+
+  // Return the number of positions in a chunk so the bitplanes of both
+  // blocks of a tile fit in the cache
+  std::size_t getChunkLen() const;
 
-  // Returns the raw number of mutations between two sequences
-  double calcRawDist( const std::string &ref, const std::string &qry );
+  // Write the distance between sequences i and j, where i > j
+  void setDist( std::size_t i, std::size_t j, double dist );
 
-  // Returns the sum of the log liklihood of substitutions between two
-  // sequences in the alignment
-  double calcSharedDist( const std::string &ref, const std::string &qry );
+  // Set the distance model to the type specified by the input argument
+  // "distFunType". If "isSparse" is true the distances from the counts of
+  // the mismatches are counted from the differences from the consensus
+  void setDistFunc( std::string distFunType, bool isSparse = false );
 
-  // Returns the log odds of the substitutions between the two sequences
-  double calcNormProbDist( const std::string &ref, const std::string &qry );
+  // Returns true if the distances of the method are calculated from the
+  // counts of the mismatches: "raw", "shared", "pDist", "JC69", "K2P" and
+  // "poisson"
+  static bool isCountMethod( const std::string &distFunType );
+
+  // Set the window of columns in the alignment to calculate the distances
+  // for
+  void setWindow( size_t start, size_t len );
+
+  // This function cacluates the subsiion probabilities between sequences
+  // in the alignmet
+  void calcSubProbabilities();
 
-  // Calculate the loglilihood of each position in the alignment -- similar
-  // to blossum distance without the scaling factor. 
-  double calcBlosum( const std::string &ref, const std::string &qry );
+  // Encode the alignment and set the table of the scores of each pair of
+  // codes from the normalized substitution matrix. If "skipMatches" is
+  // true the positions with the same amino acid are not scored
+  void setScoreTable( bool skipMatches );
 
-  // There are several ways to calculate the distance from an MSA. This
-  // provides a function pointer to be called when creating the distance
-  // matrx. By default, calculate the raw number of substitutions
-  typedef double ( MsaDistance::*DistFunction )( const std::string &refSeq,
-    const std::string &qrySeq );
-  DistFunction distFunction = &MsaDistance::calcRawDist;
+  // Returns the sum of the scores of the substitutions between two encoded
+  // sequences: the log odds of the substitutions for "normProb" and the
+  // log liklihood of each position for "logLike". This is similar to the
+  // blossum distance without the scaling factor
+  double calcScoreDist( const char *ref, const char *qry, size_t len );
 };
 #endif
 
@@ -2,11 +2,16 @@
 // [[Rcpp::plugins(cpp11)]]
 #include <Rcpp.h>
 #include <RcppParallel.h>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
 #include "BioSeq.h"
 #include "MultiSeqAlgn.h"
 #include "MsaDistance.h"
-#include "AlgnColumn.h"
+#include "AlgnColStats.h"
+#include "AlgnCompactor.h"
 #include "AlgnSubCalc.h"
+#include "DistFile.h"
 using namespace Rcpp;
 using namespace RcppParallel;
 
@@ -16,21 +21,22 @@ using namespace RcppParallel;
 // 05/11/2020
 // -----------------------------------------------------------------------------
 
-Rcpp::NumericMatrix MultiSeqAlgn::createDistMat( const std::string & distType )
+Rcpp::NumericMatrix MultiSeqAlgn::createDistMat( const std::string & distType,
+  bool isSparse
+  )
 {
   // Allocate the matrix to store the differences between aligned
   // sequences we will return
   Rcpp::NumericMatrix distMat( getNumSeqs(), getNumSeqs() );
 
   // Create the functor
-  MsaDistance msaDistance( seqs, distMat );
+  MsaDistance msaDistance( getRowPtrs(), seqLen, distMat );
 
   // Set the function pointer to the requested distance function
-  msaDistance.setDistFunc(distType );
+  msaDistance.setDistFunc( distType, isSparse );
 
-  // Call tbb::parallel_for, the code in the functor will be executed
-  // on the availible number of threads.
-  parallelFor( 0, seqs.size(), msaDistance );
+  // Calculate the distances on the availible number of threads
+  msaDistance.calcDistances();
 
   Rcpp::CharacterVector names = Rcpp::wrap( seqNames );
   rownames( distMat )         = names;
@@ -40,10 +46,266 @@ Rcpp::NumericMatrix MultiSeqAlgn::createDistMat( const std::string & distType )
   return distMat;
 }
 
+// Create an array with the matrices of the mismatches and the shared sites,
+// and of each codon position if "byCodon" is true
+Rcpp::NumericVector MultiSeqAlgn::createCountMats( bool byCodon )
+{
+  // The names of the matrices in the order they are written
+  std::vector< std::string > matNames = { "mismatches", "sites" };
+  if ( byCodon )
+  {
+    for ( int c = 1; c <= 3; c++ )
+    {
+      matNames.push_back( "mismatches" + std::to_string( c ) );
+      matNames.push_back( "sites" + std::to_string( c ) );
+    }
+  }
+
+  // Allocate the numSeqs x numSeqs x matrices array, and set the names of
+  // the sequences and the matrices
+  size_t numSeqs = getNumSeqs();
+  size_t numMats = matNames.size();
+  Rcpp::NumericVector countArray( numSeqs * numSeqs * numMats );
+  countArray.attr( "dim" ) = Rcpp::IntegerVector::create(
+    (int) numSeqs, (int) numSeqs, (int) numMats );
+  Rcpp::CharacterVector names = Rcpp::wrap( seqNames );
+  countArray.attr( "dimnames" ) =
+    Rcpp::List::create( names, names, Rcpp::wrap( matNames ) );
+
+  // The counts are the "raw" distance and the shared sites from the same
+  // pass over the bitplanes
+  MsaDistance msaDistance( getRowPtrs(), seqLen,
+    DistOutput( nullptr, numSeqs, DIST_DOUBLE ) );
+  msaDistance.setDistFunc( "raw" );
+  msaDistance.calcCountMats( byCodon, countArray.begin() );
+  return countArray;
+}
+
+// Create an R "dist" object with the condensed lower triangle of the
+// distance matrix
+Rcpp::RObject MultiSeqAlgn::createDist( const std::string &distType,
+  DistStorage storage
+  )
+{
+  DistOutput::checkStorage( distType, storage );
+  if ( storage != DIST_DOUBLE && storage != DIST_INT )
+    Rcpp::stop( "Only double or integer distances can be returned to R" );
+
+  // Allocate the condensed triangle as an R vector of the storage type
+  void *triData;
+  Rcpp::RObject distObj = allocDist( storage, triData );
+
+  // Calculate the distances on the availible number of threads
+  MsaDistance msaDistance( getRowPtrs(), seqLen,
+    DistOutput( triData, getNumSeqs(), storage ) );
+  msaDistance.setDistFunc( distType );
+  msaDistance.calcDistances();
+
+  DistOutput::setDistAttrs( distObj, seqNames, distType );
+  return distObj;
+}
+
+// Write the condensed lower triangle of the distance matrix to a binary
+// distance file
+bool MultiSeqAlgn::writeDistFile( const std::string &outPath,
+  const std::string &distType, DistStorage storage
+  )
+{
+  DistOutput::checkStorage( distType, storage );
+
+  // Set the distance function before creating the file so an unsupported
+  // method does not leave an empty file
+  MsaDistance msaDistance( getRowPtrs(), seqLen,
+    DistOutput( nullptr, getNumSeqs(), storage ) );
+  msaDistance.setDistFunc( distType );
+
+  DistFile distFile;
+  if ( !distFile.create( outPath, seqNames, storage ) ) return false;
+
+  // The distances are written directly to the mapped file
+  msaDistance.distOut = distFile.getOutput();
+  msaDistance.calcDistances();
+  return distFile.close();
+}
+
+// Update the distance matrix of the first sequences of the alignment with
+// the sequences that were added to the end of the alignment
+Rcpp::NumericMatrix MultiSeqAlgn::updateDistMat( Rcpp::NumericMatrix oldMat,
+  const std::string &distType, bool isSparse
+  )
+{
+  checkUpdateMethod( distType );
+  if ( oldMat.nrow() != oldMat.ncol() )
+    Rcpp::stop( "The distance matrix must be square" );
+  std::vector< std::string > oldNames;
+  Rcpp::RObject dimNames = oldMat.attr( "dimnames" );
+  if ( !dimNames.isNULL() )
+  {
+    Rcpp::List dimList( dimNames );
+    if ( !Rf_isNull( dimList[ 0 ] ) )
+      oldNames = Rcpp::as< std::vector< std::string > >( dimList[ 0 ] );
+  }
+  checkOldSeqs( oldMat.nrow(), oldNames );
+
+  // Copy the previous distances and calculate the distances of the added
+  // sequences
+  Rcpp::NumericMatrix distMat( getNumSeqs(), getNumSeqs() );
+  DistOutput distOut( distMat );
+  distOut.copyDists( oldMat.begin(), oldMat.nrow() );
+  MsaDistance msaDistance( getRowPtrs(), seqLen, distOut );
+  msaDistance.setDistFunc( distType, isSparse );
+  msaDistance.calcDistances( oldMat.nrow() );
+
+  Rcpp::CharacterVector names = Rcpp::wrap( seqNames );
+  rownames( distMat )         = names;
+  colnames( distMat )         = names;
+  return distMat;
+}
+
+// Update an R "dist" object with the sequences that were added to the end
+// of the alignment
+Rcpp::RObject MultiSeqAlgn::updateDist( Rcpp::RObject oldDist,
+  const std::string &distType, bool isSparse
+  )
+{
+  checkUpdateMethod( distType );
+  size_t oldNumSeqs = Rcpp::as< int >( oldDist.attr( "Size" ) );
+  std::vector< std::string > oldNames;
+  Rcpp::RObject labels = oldDist.attr( "Labels" );
+  if ( !labels.isNULL() )
+    oldNames = Rcpp::as< std::vector< std::string > >( labels );
+  checkOldSeqs( oldNumSeqs, oldNames );
+
+  // The distances must have been calculated with the same method
+  Rcpp::RObject oldMethod = oldDist.attr( "method" );
+  if ( !oldMethod.isNULL() && Rcpp::as< std::string >( oldMethod ) != distType )
+    Rcpp::stop( "The distances were calculated with the " +
+      Rcpp::as< std::string >( oldMethod ) + " method" );
+
+  // Keep the storage type of the previous distances
+  DistStorage storage = TYPEOF( oldDist ) == INTSXP ? DIST_INT : DIST_DOUBLE;
+  DistOutput::checkStorage( distType, storage );
+  size_t oldSize = Rf_xlength( oldDist );
+  if ( oldSize != DistOutput::getCondensedSize( oldNumSeqs ) )
+    Rcpp::stop( "The length of the dist object does not match its size" );
+
+  void *triData;
+  Rcpp::RObject distObj = allocDist( storage, triData );
+  DistOutput distOut( triData, getNumSeqs(), storage );
+  if ( storage == DIST_INT )
+    distOut.copyDists( Rcpp::IntegerVector( oldDist ).begin(), oldNumSeqs );
+  else
+    distOut.copyDists( Rcpp::NumericVector( oldDist ).begin(), oldNumSeqs );
+
+  MsaDistance msaDistance( getRowPtrs(), seqLen, distOut );
+  msaDistance.setDistFunc( distType, isSparse );
+  msaDistance.calcDistances( oldNumSeqs );
+
+  DistOutput::setDistAttrs( distObj, seqNames, distType );
+  return distObj;
+}
+
+// Write a binary distance file with the distances of a previous distance
+// file and the sequences that were added to the end of the alignment
+bool MultiSeqAlgn::updateDistFile( const std::string &oldPath,
+  const std::string &outPath, const std::string &distType, bool isSparse
+  )
+{
+  checkUpdateMethod( distType );
+
+  // The previous file is mapped while the new file is written, so it can
+  // not be replaced
+  if ( oldPath == outPath )
+    Rcpp::stop( "The updated distances must be written to a new file" );
+
+  DistFile oldFile;
+  if ( !oldFile.open( oldPath ) )
+    Rcpp::stop( "Unable to open the distance file " + oldPath );
+  if ( !oldFile.isComplete() )
+    Rcpp::stop( "The distance file " + oldPath + " is not complete" );
+  checkOldSeqs( oldFile.getNumSeqs(), oldFile.getSeqNames() );
+  DistStorage storage = oldFile.getStorage();
+  DistOutput::checkStorage( distType, storage );
+
+  // Set the distance function before creating the file so an unsupported
+  // method does not leave an empty file
+  MsaDistance msaDistance( getRowPtrs(), seqLen,
+    DistOutput( nullptr, getNumSeqs(), storage ) );
+  msaDistance.setDistFunc( distType, isSparse );
+
+  DistFile distFile;
+  if ( !distFile.create( outPath, seqNames, storage ) ) return false;
+  msaDistance.distOut = distFile.getOutput();
+  msaDistance.distOut.copyDists( oldFile.getData(), oldFile.getNumSeqs() );
+  msaDistance.calcDistances( oldFile.getNumSeqs() );
+  return distFile.close();
+}
+
+// Allocate an R vector for the condensed lower triangle
+Rcpp::RObject MultiSeqAlgn::allocDist( DistStorage storage,
+  void *&triData
+  ) const
+{
+  size_t triSize = DistOutput::getCondensedSize( getNumSeqs() );
+  if ( storage == DIST_DOUBLE )
+  {
+    Rcpp::NumericVector dists( triSize );
+    triData = dists.begin();
+    return dists;
+  }
+  Rcpp::IntegerVector dists( triSize );
+  triData = dists.begin();
+  return dists;
+}
+
+// Stop with an error if the previous distances of an update could differ
+// from the distances of the extended alignment
+void MultiSeqAlgn::checkUpdateMethod( const std::string &distType )
+{
+  if ( !MsaDistance::isCountMethod( distType ) )
+    Rcpp::stop( "Only the distances from the counts of the mismatches can " +
+      std::string( "be updated: \"raw\", \"shared\", \"pDist\", " ) +
+      "\"JC69\", \"K2P\" and \"poisson\"" );
+}
+
+// Stop with an error if the sequences of a previous distance matrix are not
+// the first sequences of the alignment
+void MultiSeqAlgn::checkOldSeqs( size_t oldNumSeqs,
+  const std::vector< std::string > &oldNames
+  ) const
+{
+  if ( oldNumSeqs > (size_t) getNumSeqs() )
+    Rcpp::stop( "The distance matrix has more sequences than the alignment" );
+  if ( oldNames.empty() ) return;
+  if ( oldNames.size() != oldNumSeqs ||
+       !std::equal( oldNames.begin(), oldNames.end(), seqNames.begin() ) )
+    Rcpp::stop( "The sequences of the distance matrix must be the first " +
+      std::string( "sequences of the alignment in the same order" ) );
+}
+
 // This function reads in the fasta file containing the msa and makes sure
 // the file is valid for downstream analysis
 void MultiSeqAlgn::parseMsa()
 {
+  // A binary alignment is mapped and used without parsing
+  if ( AlgnFile::isAlgnFile( faPath ) )
+  {
+    if ( !algnFile.open( faPath ) )
+      Rcpp::stop( "Unable to open the binary alignment for reading\n" );
+
+    this->seqLen = algnFile.getAlgnLen();
+    seqNames     = algnFile.getSeqNames();
+    partitions   = algnFile.getPartitions();
+    algnRows     = algnFile.getRows();
+    algnCols     = algnFile.getCols();
+    curSeqName   = seqNames.begin();
+    maxSeqIdx    = seqNames.size() - 1;
+
+    if ( !seqLen || seqNames.empty() )
+      Rcpp::stop( "There are no sequences in this alignment...\n" );
+    return;
+  }
+
   if ( ! parseFasta() )
    Rcpp::stop("Unable to open the alignment for reading\n");
 
@@ -60,249 +322,320 @@ void MultiSeqAlgn::parseMsa()
     if ( it->size() != seqLen )
       Rcpp::stop( "The alignments must be the same length...\n" );
   }
+
+  // Copy the sequences into a single row-major buffer and free the strings
+  std::vector< char > newBuf( seqs.size() * seqLen );
+  for ( size_t i = 0; i < seqs.size(); i++ )
+    std::copy( seqs[ i ].begin(), seqs[ i ].end(),
+      newBuf.begin() + i * seqLen );
+  std::vector< std::string >().swap( seqs );
+  setAlgnBuf( newBuf, seqLen );
 }
 
-// Create a vector with iterators to each sequence in the alignment
-std::vector< std::string::iterator > MultiSeqAlgn::getSeqIterators()
+// Remove columns from the alignment. A mapped alignment is copied into a
+// new buffer, otherwise the buffer is compacted in place
+void MultiSeqAlgn::compactAlgn( const AlgnCompactor &compactor )
 {
-  // Allocate sufficient space for each sequence in the alignment
-  std::vector< std::string::iterator > seqIts;
-  seqIts.reserve( seqs.size() );
-
-  // Iterate over the alignment and get a pointer to the start of each
-  // sequence in the alginment
-  for ( auto it = seqs.begin(); it != seqs.end(); it++ )
-    seqIts.push_back( it->begin() );
+  size_t numSeqs = getNumSeqs();
+  if ( algnBuf.size() )
+  {
+    compactor.compact( algnBuf, numSeqs );
+    seqLen   = compactor.getNewLen();
+    algnRows = algnBuf.data();
+  }
+  else
+  {
+    std::vector< char > newBuf( numSeqs * compactor.getNewLen() );
+    compactor.compact( algnRows, newBuf.data(), numSeqs );
+    setAlgnBuf( newBuf, compactor.getNewLen() );
+  }
 
-  return seqIts;
+  // The partitions of a binary alignment are remapped with the columns
+  compactor.remapPositions( partitions );
 }
 
-// Iterate over each position in the alignment and remove any position with
-// a gap to generte the core genome alignment
-
-void MultiSeqAlgn::filterMsaColumns( double minGapFrac,
-  int minSubThresh, std::vector<int> & genePositions
-  )
+// Replace the alignment with a new row-major buffer
+void MultiSeqAlgn::setAlgnBuf( std::vector< char > &newBuf, size_t newLen )
 {
-  // Create iterators for each sequence in the alignment
-  auto seqIts = getSeqIterators();
+  algnBuf.swap( newBuf );
+  seqLen   = newLen;
+  algnRows = algnBuf.data();
 
-  // Check each column in the alignment there there is at least one
-  // subsitiution and there there is less than 50% gaps
-  std::vector< AlgnColumn > algnCols;
-  algnCols.reserve( seqLen );
-  for ( unsigned int i = 0; i < seqLen; i++ )
-    algnCols.push_back( AlgnColumn(& seqs, i ) );
-
-  // Use tbb parallel for to iterate over each column in the alingmnet and
-  // check that each position is of sufficient quality
-  tbb::parallel_for_each(
-    algnCols.begin(),
-    algnCols.end(),
-    [&] ( AlgnColumn & algnColumn )
-  {
-    algnColumn.calcColStats( minGapFrac, minSubThresh );
-  });
+  // The columns of a mapped alignment no longer match the alignment
+  algnCols = nullptr;
+  algnFile.close();
+}
 
-  // Allocate a new vector with the new alignment sequnces
-  std::vector< std::string > filterSeqs( seqs.size() );
+// Returns the number of sequences in the alignment
+int MultiSeqAlgn::getNumSeqs() const
+{
+  return seqNames.size();
+}
 
-  // Reserve enough space for each string to encompass the entire alignments
-  for ( auto & seq : filterSeqs ) seq.reserve( seqLen );
+// Returns the length of the alignment
+size_t MultiSeqAlgn::getAlgnLen() const
+{
+  return seqLen;
+}
 
-  // Iterate over each position in the alignment and copy over each char
-  // that meets the criteria for inclusion in the alignment
-  for ( auto it = algnCols.begin(); it != algnCols.end(); it++ )
+// Returns the alphabet of the alignment
+AlgnAlphabet MultiSeqAlgn::getAlphabet()
+{
+  if ( !isAlphabetSet )
   {
-    // If there are too many gaps or no variants at this position in the
-    // alignment, advance the iterators
-    if ( it->getColStatus() )
-    {
-      // Get the current column
-      auto colIdx = std::distance( algnCols.begin(), it );
+    algnAlphabet  = findAlphabet( getRowPtrs(), seqLen );
+    isAlphabetSet = true;
+  }
+  return algnAlphabet;
+}
 
-      // Add this position to the filtered alignment
-      for ( unsigned int i = 0; i < seqs.size(); i ++ )
-        filterSeqs[ i ].push_back( seqs[ i ][ colIdx ] );
-    }
+// Returns the end position of each partition stored in a binary alignment
+const std::vector< int > &MultiSeqAlgn::getPartitions() const
+{
+  return partitions;
+}
 
-    R_CheckUserInterrupt();
-  }
+// Create a vector with a pointer to the start of each sequence in the
+// alignment
+std::vector< const char * > MultiSeqAlgn::getRowPtrs() const
+{
+  std::vector< const char * > rowPtrs( getNumSeqs() );
+  for ( size_t i = 0; i < rowPtrs.size(); i++ )
+    rowPtrs[ i ] = algnRows + i * seqLen;
+  return rowPtrs;
+}
 
-  // Get rid of any unused space
-  for ( auto & seq : filterSeqs ) seq.shrink_to_fit();
+// This function returns the sequences in the alignment as a vector
+std::vector< std::string > MultiSeqAlgn::getSeqs() const
+{
+  std::vector< std::string > algnSeqs;
+  algnSeqs.reserve( getNumSeqs() );
+  for ( auto row : getRowPtrs() ) algnSeqs.emplace_back( row, seqLen );
+  return algnSeqs;
+}
 
-  // Reseq the sequences in the msa to the filtered sequences
-  seqs = filterSeqs;
+// Write the alignment in a multi-fasta file
+bool MultiSeqAlgn::writeSeqs( std::string outFasta ) const
+{
+  std::ofstream ofs( outFasta.c_str(), std::ios::binary );
+  if ( ofs.fail() ) return false;
 
-  // If a vector of gene positions was input, update the vector so it now
-  // reflects the gene partitions that were erased
-  if ( genePositions.size() )
+  for ( int i = 0; i < getNumSeqs(); i++ )
   {
-    int algnIdx   = 0; // Position in the alignment
-    int numErased = 0; // Nnumber of positions in the alignemt that were erased
-
-    // Iterate over each position in the alignment
-    for ( auto & pos : genePositions )
-    {
-      while ( algnIdx <= pos )
-      {
-        algnIdx ++;
-        if ( !algnCols[ algnIdx ].getColStatus() ) numErased ++;
-      }
+    ofs << '>' << seqNames[ i ] << '\n';
+    ofs.write( algnRows + i * seqLen, seqLen );
+    ofs << '\n';
+  }
+  ofs.close();
 
-      pos -= numErased;
+  return !ofs.fail();
+}
 
-      R_CheckUserInterrupt();
-    }
-  }
+// Write the alignment in the binary format
+bool MultiSeqAlgn::writeAlgnFile( const std::string &outPath,
+  const std::vector< int > &partitions, bool addCols ) const
+{
+  return AlgnFile::write( outPath, seqNames, algnRows, getNumSeqs(), seqLen,
+    partitions, addCols );
 }
 
+// Iterate over each position in the alignment and remove any position with
+// a gap to generte the core genome alignment
 
-std::list< Rcpp::NumericMatrix > MultiSeqAlgn::calcAlignPartitionDists(
-  std::string distType, std::vector< int > genePartitions
+void MultiSeqAlgn::filterMsaColumns( double minGapFrac,
+  int minSubThresh, std::vector<int> & genePositions
   )
 {
-  // Initialize the list, reserving the number of matricies to output
-  std::list< Rcpp::NumericMatrix > distMatList;
+  size_t numSeqs = getNumSeqs();
 
-  // Initialize the start of the gene partition
-  unsigned int gStart;
-  unsigned int numSeqs = getNumSeqs();
-  unsigned int len;
+  // Check each column in the alignment there there is at least one
+  // subsitiution and there there is less than 50% gaps. The columns are
+  // read from the column-major alignment if it is available
+  AlgnColStats colStats( algnRows, algnCols, numSeqs, seqLen,
+    getAlphabet() );
+  colStats.calcColStats( minGapFrac, minSubThresh );
+
+  // Remove the columns that do not meet the criteria for inclusion in the
+  // alignment, and update the gene positions if they were input so they
+  // reflect the positions that were erased
+  AlgnCompactor compactor( colStats.getKeepMask() );
+  compactAlgn( compactor );
+  compactor.remapPositions( genePositions );
+}
 
-  // Convert the row names to an Rcpp character vector to be used as the
-  // row and column names
+// Create an array with the distance matrix of each partition
+Rcpp::NumericVector MultiSeqAlgn::calcAlignPartitionDists(
+  const std::string &distType, const std::vector< int > &genePartitions
+  )
+{
+  // Allocate the numSeqs x numSeqs x partitions array, and set the row and
+  // column names of the matrices
+  size_t numSeqs  = getNumSeqs();
+  size_t numParts = genePartitions.size();
+  Rcpp::NumericVector distArray( numSeqs * numSeqs * numParts );
+  distArray.attr( "dim" ) = Rcpp::IntegerVector::create(
+    (int) numSeqs, (int) numSeqs, (int) numParts );
   Rcpp::CharacterVector names = Rcpp::wrap( seqNames );
+  distArray.attr( "dimnames" ) =
+    Rcpp::List::create( names, names, R_NilValue );
 
-  // Allocate the matrix to store the differences between aligned
-  // sequences we will return
-  Rcpp::NumericMatrix distMat( numSeqs, numSeqs );
-
-  // Initialize the functor with the entire alignment
-  MsaDistance msaDistance( seqs, distMat );
+  std::vector< size_t > partEnds( numParts );
+  for ( size_t i = 0; i < numParts; i++ )
+  {
+    if ( genePartitions[ i ] < 0 )
+      Rcpp::stop( "The partitions must be inside of the alignment" );
+    partEnds[ i ] = genePartitions[ i ];
+  }
 
   // Set the function pointer to the requested distance function. If the
   // function type requires, the alignment substitution probabilities are
   // calculated once on the entire alignment
+  MsaDistance msaDistance( getRowPtrs(), seqLen,
+    DistOutput( nullptr, numSeqs, DIST_DOUBLE ) );
   msaDistance.setDistFunc( distType );
 
-  // For each set of patitions
-  for ( unsigned  int i = 0; i < genePartitions.size(); i++ )
-  {
-    if ( i == 0 ) gStart = 0;
-    else gStart = genePartitions[ i - 1 ];
-    len = genePartitions[ i ] - gStart;
-
-    // Create an alignment with only the sequences in the partitions
-    std::vector< std::string > subSeqs( numSeqs );
-    for ( unsigned int j = 0; j < numSeqs; j++ )
-      subSeqs[ j ] = seqs[ j ].substr( gStart, len );
-
-    // Set the sequences to calculate the distance for to the subsequence
-    // corresponding to this partition
-    msaDistance.setMsaSeqs( subSeqs );
-
-    // Call tbb::parallel_for, the code in the functor will be executed
-    // on the availible number of threads.
-    parallelFor( 0, numSeqs, msaDistance );
-
-    // Set the row and column names
-    rownames( distMat ) = names;
-    colnames( distMat ) = names;
+  // Calculate every partition in one pass on the availible number of
+  // threads
+  msaDistance.calcPartitionDists( partEnds, distArray.begin() );
+  return distArray;
+}
 
-    // Set the row and column names of the matirx and Return
-    distMatList.push_back( Rcpp::clone( distMat ) );
+// Calculate the mean "raw" distance per position between the pairs of
+// sequences in each partition from the symbol counts of the columns
+std::vector< double > MultiSeqAlgn::calcPartitionVariability(
+  const std::vector< int > &genePartitions
+  )
+{
+  AlgnColStats colStats( algnRows, algnCols, getNumSeqs(), seqLen,
+    getAlphabet() );
+  colStats.calcMismatchPairs();
+  const std::vector< uint64_t > &mismatchPairs = colStats.getMismatchPairs();
+
+  // The sum of the distances of a partition is the sum of the pairs that
+  // differ at each of its columns
+  double numPairs = getNumSeqs() * ( getNumSeqs() - 1.0 ) / 2;
+  std::vector< double > partVars( genePartitions.size(), 0 );
+  for ( size_t i = 0; i < genePartitions.size(); i++ )
+  {
+    int pStart = i ? genePartitions[ i - 1 ] : 0;
+    int pEnd   = genePartitions[ i ];
+    if ( pEnd < pStart || pEnd > (int) seqLen )
+      Rcpp::stop( "The partitions must be in order and inside of the " +
+        std::string( "alignment" ) );
+
+    uint64_t numMismatch = 0;
+    for ( int c = pStart; c < pEnd; c++ ) numMismatch += mismatchPairs[ c ];
+    if ( pEnd > pStart && numPairs > 0 )
+      partVars[ i ] = numMismatch / numPairs / ( pEnd - pStart );
   }
-
-  return distMatList;
+  return partVars;
 }
 
 // Delete a selected partitions in the alignment
 void MultiSeqAlgn::deletePartitions( const std::vector<int> &delStart,
   const std::vector<int> &delEnd )
 {
-  // Get an iterator with the beginning of each string
-  auto seqIts = getSeqIterators();
-
-  // Iterate over the partitions to be delected and remove them from each
-  // sequence in the alignement
-  int delLen = 0;
-
-  // Iterate over each partions to delete
   for ( unsigned int i = 0; i < delStart.size(); i++ )
   {
-    for ( unsigned int j = 0; j < seqs.size(); j++ )
-    {
-      // Find the position to erase and delete the sequence from the alignmnt
-      auto curStart = seqIts[ j ] + ( delStart[ i ] - delLen );
-      auto curEnd = seqIts[ j ] + ( delEnd[ i ] - delLen + 1 );
-      seqs[ j ].erase( curStart, curEnd );
-    }
-
-    // Keep track of how much of the sequence has been deleted to adjust the
-    // start positions
-    delLen += delEnd[i] - delStart[i] + 1;
+    if ( delStart[ i ] < 0 || delEnd[ i ] < delStart[ i ] ||
+         delEnd[ i ] >= (int) seqLen )
+      Rcpp::stop( "The partitions to delete must be inside of the alignment" );
   }
+
+  // Remove the partitions from each sequence in the alignment
+  compactAlgn( AlgnCompactor( delStart, delEnd, seqLen ) );
 }
 
-std::vector< double > MultiSeqAlgn::calcAlgnQualScores(
+const size_t MultiSeqAlgn::NUM_QUAL_STATS;
+const size_t MultiSeqAlgn::QUAL_BUF_DISTS;
+
+// Calculate the distribution of the distances between the sequences in
+// sliding windows of the alignment
+Rcpp::NumericMatrix MultiSeqAlgn::calcAlgnQualScores(
   std::string method, int stepVal, int windowSize
   )
 {
-  // Initialize the start of the gene partition
-  unsigned int numSeqs = getNumSeqs();
-
-  // Allocate the matrix to store the differences between aligned
-  // sequences we will return
-  Rcpp::NumericMatrix distMat( numSeqs, numSeqs );
-
-  // Initialize the functor with the entire alignment
-  MsaDistance msaDistance( seqs, distMat );
-
-  // Set the function pointer to the requested distance function. If the
-  // function type requires, the alignment substitution probabilities are
-  // calculated once on the entire alignment
+  size_t numSeqs = getNumSeqs();
+  if ( numSeqs < 2 )
+    Rcpp::stop( "At least two sequences are needed to score the alignment" );
+  if ( stepVal < 1 || windowSize < 1 )
+    Rcpp::stop( "The step and window size must be positive" );
+
+  // Find the start of each window. The windows end before the end of the
+  // alignment
+  std::vector< size_t > winStarts;
+  for ( size_t start = 0; start + windowSize < seqLen; start += stepVal )
+    winStarts.push_back( start );
+
+  // Calculate the distances of as many windows at a time as fit in the
+  // buffer. The pairs keep their running counts between the batches
+  size_t numPairs = DistOutput::getCondensedSize( numSeqs );
+  size_t numBatch = std::max( QUAL_BUF_DISTS / numPairs, size_t( 1 ) );
+  numBatch = std::min( numBatch, std::max( winStarts.size(), size_t( 1 ) ) );
+  std::vector< double > winDists( numBatch * numPairs );
+
+  // Initialize the functor with the entire alignment and set the function
+  // pointer to the requested distance function
+  MsaDistance msaDistance( getRowPtrs(), seqLen,
+    DistOutput( winDists.data(), numSeqs, DIST_DOUBLE ) );
   msaDistance.setDistFunc( method );
 
-  //
-  unsigned int startPos = 0;
-  unsigned int endPos   = windowSize;
-
-  //
-  std::vector< double > minDistVals;
-
-  while ( endPos < seqLen )
+  // One row for each window with its position and the distribution of the
+  // distances in the window
+  Rcpp::NumericMatrix qualScores( winStarts.size(), NUM_QUAL_STATS );
+  for ( size_t b = 0; b < winStarts.size(); b += numBatch )
   {
-    // Create an alignment with only the sequences in the partitions
-    std::vector< std::string > subSeqs( numSeqs );
-    for ( unsigned int j = 0; j < numSeqs; j++ )
-      subSeqs[ j ] = seqs[ j ].substr( startPos, windowSize );
-
-    // Set the sequences to calculate the distance for to the subsequence
-    // corresponding to this partition
-    msaDistance.setMsaSeqs( subSeqs );
-
-    // Call tbb::parallel_for, the code in the functor will be executed
-    // on the availible number of threads.
-    parallelFor( 0, numSeqs, msaDistance );
-
-
-    double minVal = distMat( 0 , 1 );
-    for ( int i = 0; i < distMat.nrow(); i++ )
-     for ( int j = i + 1; j < distMat.ncol(); j++ )
-       if ( distMat( i , j ) < minVal ) minVal = distMat( i , j );
+    std::vector< size_t > batchStarts( winStarts.begin() + b,
+      winStarts.begin() + std::min( b + numBatch, winStarts.size() ) );
+    msaDistance.calcSlidingDists( batchStarts, windowSize, winDists.data() );
 
+    // Find the distribution of each window in parallel
+    tbb::parallel_for( size_t( 0 ), batchStarts.size(), [&] ( size_t w )
+    {
+      double stats[ NUM_QUAL_STATS ];
+      stats[ 0 ] = batchStarts[ w ] + 1;
+      stats[ 1 ] = batchStarts[ w ] + windowSize;
+      calcDistStats( winDists.data() + w * numPairs, numPairs, stats + 2 );
+      for ( size_t k = 0; k < NUM_QUAL_STATS; k++ )
+        qualScores( b + w, k ) = stats[ k ];
+    });
+    Rcpp::checkUserInterrupt();
+  }
 
-    // Set the row and column names of the matirx and Return
-    minDistVals.push_back( minVal );
+  Rcpp::colnames( qualScores ) = Rcpp::CharacterVector::create( "start",
+    "end", "min", "q25", "median", "q75", "max", "mean" );
+  return qualScores;
+}
 
-    // Increment he start position by the window size
-    startPos += stepVal;
-    endPos   = startPos + windowSize;
+// Calculate the minimum, quartiles, maximum and mean of the distances.
+// The quartiles are interpolated between the order statistics as in R's
+// default quantile type, and each order statistic is found with a partial
+// sort of the distances after the previous one
+void MultiSeqAlgn::calcDistStats( double *dists, size_t numDists,
+  double *stats
+  )
+{
+  static const double probs[ 3 ] = { 0.25, 0.5, 0.75 };
+  double *distEnd = dists + numDists;
+  double *sorted  = dists;
+  for ( size_t k = 0; k < 3; k++ )
+  {
+    double  h  = ( numDists - 1 ) * probs[ k ];
+    size_t  lo = std::floor( h );
+    double *loPos = dists + lo;
+    std::nth_element( sorted, loPos, distEnd );
+    double loVal = *loPos;
+    double hiVal = loPos + 1 < distEnd ?
+      *std::min_element( loPos + 1, distEnd ) : loVal;
+    stats[ k + 1 ] = loVal + ( h - lo ) * ( hiVal - loVal );
+    sorted = loPos;
   }
+  stats[ 0 ] = *std::min_element( dists, distEnd );
+  stats[ 4 ] = *std::max_element( sorted, distEnd );
 
-  return minDistVals;
+  double distSum = 0;
+  for ( double *pos = dists; pos < distEnd; pos++ ) distSum += *pos;
+  stats[ 5 ] = distSum / numDists;
 }
 
 // -----------------------------------------------------------------------------
@@ -3,6 +3,10 @@
 #include <Rcpp.h>
 #include <RcppParallel.h>
 #include "BioSeq.h"
+#include "AlgnFile.h"
+#include "AlgnCompactor.h"
+#include "DistOutput.h"
+#include "Alphabet.h"
 using namespace RcppParallel;
 
 // -----------------------------------------------------------------------------
@@ -13,7 +17,11 @@ using namespace RcppParallel;
 // This class provides function for parsing and manipulating multiple sequence
 // alignments. Functionality is provided to remove gaps from the alignment
 // to retrieve the core genome. Then a distance matrix can be calculated
-// with the paiwise distances between the sequences in the alignmnet
+// with the paiwise distances between the sequences in the alignmnet. The
+// alignment is read from either a fasta file or the binary alignment format.
+// A fasta alignment is parsed into a single row-major buffer, and a binary
+// alignment is mapped and used in place. The functions operate on pointers
+// to the rows of the alignment so both are handled the same way.
 // -----------------------------------------------------------------------------
 
 // Define a static vector to stand in for the vector of integers
@@ -26,43 +34,175 @@ class MultiSeqAlgn : public BioSeq
 {
 public:
 
-  // This ctor takes the path to the msa in fasta format and creates the
-  // BioSeq class object to parse the
-  MultiSeqAlgn( std::string faPath ): BioSeq( faPath )
+  // This ctor takes the path to the msa in fasta or binary format and
+  // creates the BioSeq class object to parse the
+  MultiSeqAlgn( std::string faPath ): BioSeq( faPath ), seqLen( 0 ),
+    algnRows( nullptr ), algnCols( nullptr ), isAlphabetSet( false )
   { ; }
 
-  // Create a distance matrix from
-  Rcpp::NumericMatrix createDistMat( const std::string & distType );
+  // Create a distance matrix from. If "isSparse" is true the distances are
+  // counted from the differences of each sequence from the consensus
+  Rcpp::NumericMatrix createDistMat( const std::string & distType,
+    bool isSparse = false );
+
+  // Create an array with the matrices of the mismatches and the shared
+  // sites between the sequences, counted in a single pass. If "byCodon" is
+  // true the matrices of each codon position are added. Returns a numSeqs
+  // x numSeqs x matrices array with the names of the matrices
+  Rcpp::NumericVector createCountMats( bool byCodon );
+
+  // Create an R "dist" object with the condensed lower triangle of the
+  // distance matrix. The distances are stored as doubles or integers
+  Rcpp::RObject createDist( const std::string &distType,
+    DistStorage storage );
+
+  // Write the condensed lower triangle of the distance matrix to a binary
+  // distance file without holding the matrix in memory
+  bool writeDistFile( const std::string &outPath, const std::string &distType,
+    DistStorage storage );
+
+  // Update the distance matrix of the first sequences of the alignment
+  // with the sequences that were added to the end of the alignment. Only
+  // the distances of the added sequences are calculated
+  Rcpp::NumericMatrix updateDistMat( Rcpp::NumericMatrix oldMat,
+    const std::string &distType, bool isSparse );
+
+  // Update an R "dist" object with the sequences that were added to the
+  // end of the alignment
+  Rcpp::RObject updateDist( Rcpp::RObject oldDist,
+    const std::string &distType, bool isSparse );
+
+  // Write a binary distance file with the distances of a previous distance
+  // file and the sequences that were added to the end of the alignment
+  bool updateDistFile( const std::string &oldPath,
+    const std::string &outPath, const std::string &distType, bool isSparse );
 
   // This function reads in the fasta file containing the msa and makes sure
-  // the file is valid for downstream analysis
+  // the file is valid for downstream analysis. If the file is a binary
+  // alignment it is mapped instead of parsed.
   void parseMsa();
 
+  // Returns the number of sequences in the alignment
+  int getNumSeqs() const;
+
+  // Returns the length of the alignment
+  size_t getAlgnLen() const;
+
+  // Returns the alphabet of the alignment, nucleotides or amino acids. The
+  // alphabet is found from the chars of the alignment the first time it is
+  // needed
+  AlgnAlphabet getAlphabet();
+
+  // Returns the end position of each partition stored in a binary
+  // alignment. Empty for a fasta alignment
+  const std::vector< int > &getPartitions() const;
+
+  // Create a vector with a pointer to the start of each sequence in the
+  // alignment
+  std::vector< const char * > getRowPtrs() const;
+
+  // This function returns the sequences in the alignment as a vector
+  std::vector< std::string > getSeqs() const;
+
+  // Write the alignment in a multi-fasta file
+  bool writeSeqs( std::string faPath ) const;
+
+  // Write the alignment in the binary format with the end position of each
+  // partition. If "addCols" is true the column-major section is included
+  bool writeAlgnFile( const std::string &outPath,
+    const std::vector< int > &partitions, bool addCols ) const;
+
   // Iterate over each position in the alignment and remove any position with
   // a gap to generte the core genome alignment
   void filterMsaColumns( double minGapFrac,  int minSubThresh,
      std::vector<int> & genePositions=DEFAULT_VECTOR );
 
-  // Create a list distance matricies for each of the individual partitions.
-  // The specified by the input vector of integers.
-  std::list< Rcpp::NumericMatrix > calcAlignPartitionDists(
-    std::string distType, std::vector< int > genePartitions );
+  // Create an array with the distance matrix of each partition. The
+  // partitions are contiguous from the start of the alignment and are
+  // specified by the end of each partition. The matrices are calculated in
+  // a single pass and returned as a numSeqs x numSeqs x partitions array
+  Rcpp::NumericVector calcAlignPartitionDists( const std::string &distType,
+    const std::vector< int > &genePartitions );
+
+  // Calculate the variability of each partition as the mean "raw"
+  // distance per position between every pair of sequences. The distances
+  // are not calculated, the sum over the pairs is found from the symbol
+  // counts of each column of the partition
+  std::vector< double > calcPartitionVariability(
+    const std::vector< int > &genePartitions );
 
   // Delete a selected partitions in the alignment
   void deletePartitions( const std::vector<int> &delStart,
     const std::vector<int> &delEnd );
 
-  //
-  std::vector< double > calcAlgnQualScores(
+  // Score the quality of the alignment in sliding windows of "windowSize"
+  // positions that start every "stepVal" positions. Returns a matrix with
+  // the 1-based start and end of each window and the minimum, quartiles,
+  // maximum and mean of the distances between the sequences in the window.
+  // The running distances of the pairs are updated with only the positions
+  // that enter and leave the window
+  Rcpp::NumericMatrix calcAlgnQualScores(
     std::string method, int stepVal, int windowSize );
 
 private:
 
-  // Create a vector with iterators to each sequence in the alignment
-  std::vector< std::string::iterator > getSeqIterators();
-
   // The length of the msa
-  unsigned int seqLen;
+  size_t seqLen;
+
+  // The mapped binary alignment
+  AlgnFile algnFile;
+
+  // Row-major buffer with the alignment when it is not mapped from a
+  // binary alignment
+  std::vector< char > algnBuf;
+
+  // Pointer to the start of the row-major alignment
+  const char *algnRows;
+
+  // Pointer to the start of the column-major alignment, null if the
+  // alignment was not read from a binary alignment with columns
+  const char *algnCols;
+
+  // End position of each partition from a binary alignment
+  std::vector< int > partitions;
+
+  // The alphabet of the alignment and a bool indicating that it was found
+  AlgnAlphabet algnAlphabet;
+  bool         isAlphabetSet;
+
+  // Number of columns of the quality scores of each window
+  static const size_t NUM_QUAL_STATS = 8;
+
+  // Maximum number of distances of the windows that are scored at a time
+  static const size_t QUAL_BUF_DISTS = 1 << 24;
+
+  // Calculate the minimum, quartiles, maximum and mean of the distances.
+  // The distances are reordered
+  static void calcDistStats( double *dists, size_t numDists, double *stats );
+
+  // Replace the alignment with a new row-major buffer
+  void setAlgnBuf( std::vector< char > &newBuf, size_t newLen );
+
+  // Remove the columns from the alignment that are not kept by the
+  // compactor
+  void compactAlgn( const AlgnCompactor &compactor );
+
+  // Allocate an R vector of the storage type for the condensed lower
+  // triangle of the distance matrix and set "triData" to its start
+  Rcpp::RObject allocDist( DistStorage storage, void *&triData ) const;
+
+  // Stop with an error if the distances of the method cannot be updated.
+  // Only the distances from the counts of the mismatches are the same for
+  // the previous sequences of the extended alignment. The substitution
+  // matrix of the "normProb" and "logLike" distances changes when the
+  // sequences are added
+  static void checkUpdateMethod( const std::string &distType );
+
+  // Stop with an error if the sequences of a previous distance matrix are
+  // not the first sequences of the alignment. The names are not checked if
+  // the matrix does not have names
+  void checkOldSeqs( size_t oldNumSeqs,
+    const std::vector< std::string > &oldNames ) const;
 };
 #endif
 
@@ -0,0 +1,475 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include "NjTree.h"
+#include "DistFile.h"
+
+// -----------------------------------------------------------------------------
+// NjTree
+// Ryan D. Crawford
+// 2020/12/17
+// -----------------------------------------------------------------------------
+
+// Number of blocks of rows searched in parallel for the pair to join
+static const size_t NJ_SEARCH_BLOCKS = 256;
+
+// Number of rows of the lower triangle that are sorted together
+static const size_t NJ_ROW_BLOCK = 64;
+
+// Relative error of a distance rounded to a float, with some margin. Used
+// to bound the distance from below when a sorted row is searched
+static const double NJ_FLOAT_ERR = 1.0 / ( 1 << 22 );
+
+// Compare two sorted row entries by distance and then node. A functor so
+// the comparison is inlined by std::sort
+struct SortedDistLess
+{
+  bool operator()( const SortedDist &a, const SortedDist &b ) const
+  {
+    return a.dist < b.dist || ( a.dist == b.dist && a.node < b.node );
+  }
+};
+
+// Return true if a pair has a smaller Q-value than the best pair, or the
+// same Q-value and comes first
+static inline bool isBetterPair( double q, size_t i, size_t j, double bestQ,
+  size_t bestI, size_t bestJ
+  )
+{
+  return q < bestQ ||
+    ( q == bestQ && ( i < bestI || ( i == bestI && j < bestJ ) ) );
+}
+
+// Set the distances from a square distance matrix
+void NjTree::setDistMat( Rcpp::NumericMatrix distMat )
+{
+  if ( distMat.nrow() != distMat.ncol() )
+    Rcpp::stop( "The distance matrix must be square" );
+  std::vector< std::string > names;
+  Rcpp::RObject dimNames = distMat.attr( "dimnames" );
+  if ( !dimNames.isNULL() )
+  {
+    Rcpp::List dimList( dimNames );
+    if ( !Rf_isNull( dimList[ 0 ] ) )
+      names = Rcpp::as< std::vector< std::string > >( dimList[ 0 ] );
+  }
+  setSeqNames( distMat.nrow(), names );
+
+  // Copy the lower triangle one column at a time
+  dists.resize( DistOutput::getCondensedSize( numSeqs ) );
+  const double *matData = distMat.begin();
+  for ( size_t j = 0; j + 1 < numSeqs; j++ )
+    std::copy( matData + j * numSeqs + j + 1, matData + ( j + 1 ) * numSeqs,
+      dists.begin() + getIdx( j + 1, j ) );
+}
+
+// Set the distances from an R "dist" object
+void NjTree::setDist( Rcpp::RObject distObj )
+{
+  std::vector< std::string > names;
+  Rcpp::RObject labels = distObj.attr( "Labels" );
+  if ( !labels.isNULL() )
+    names = Rcpp::as< std::vector< std::string > >( labels );
+  setSeqNames( Rcpp::as< int >( distObj.attr( "Size" ) ), names );
+
+  if ( (size_t) Rf_xlength( distObj ) !=
+       DistOutput::getCondensedSize( numSeqs ) )
+    Rcpp::stop( "The length of the dist object does not match its size" );
+  if ( TYPEOF( distObj ) == INTSXP )
+  {
+    Rcpp::IntegerVector intDists( distObj );
+    dists.assign( intDists.begin(), intDists.end() );
+  }
+  else
+  {
+    Rcpp::NumericVector numDists( distObj );
+    dists.assign( numDists.begin(), numDists.end() );
+  }
+}
+
+// Set the distances from a binary distance file
+bool NjTree::readDistFile( const std::string &distPath )
+{
+  DistFile distFile;
+  if ( !distFile.open( distPath ) ) return false;
+  if ( !distFile.isComplete() )
+    Rcpp::stop( "The distance file " + distPath + " is not complete" );
+  setSeqNames( distFile.getNumSeqs(), distFile.getSeqNames() );
+  dists.resize( DistOutput::getCondensedSize( numSeqs ) );
+  distFile.copyDists( dists.data() );
+  return true;
+}
+
+// Set the names of the sequences
+void NjTree::setSeqNames( size_t numSeqs,
+  const std::vector< std::string > &names
+  )
+{
+  // The joined nodes are numbered after the leaves
+  if ( numSeqs > (size_t) std::numeric_limits< int32_t >::max() / 2 )
+    Rcpp::stop( "Too many sequences to build a tree" );
+  this->numSeqs = numSeqs;
+  if ( names.size() == numSeqs )
+  {
+    seqNames = names;
+    return;
+  }
+  seqNames.resize( numSeqs );
+  for ( size_t i = 0; i < numSeqs; i++ )
+    seqNames[ i ] = std::to_string( i + 1 );
+}
+
+// Join the sequences into an unrooted tree
+void NjTree::buildTree()
+{
+  if ( numSeqs < 2 )
+    Rcpp::stop( "At least two sequences are needed to build a tree" );
+  for ( double dist : dists )
+  {
+    if ( !std::isfinite( dist ) )
+      Rcpp::stop( "The distances must be finite to build a tree" );
+  }
+
+  size_t numNodes = 2 * numSeqs - 1;
+  leftNodes.assign( numNodes, -1 );
+  rightNodes.assign( numNodes, -1 );
+  branchLens.assign( numNodes, 0 );
+  rootNodes.clear();
+  initRows();
+
+  // Compact the sorted rows each time half of the nodes are joined
+  size_t compactSize = activePos.size() / 2;
+  while ( activePos.size() > 3 )
+  {
+    size_t minI, minJ;
+    findMinPair( minI, minJ );
+    joinPair( minI, minJ );
+
+    if ( activePos.size() <= compactSize )
+    {
+      compactRows();
+      compactSize = activePos.size() / 2;
+    }
+    Rcpp::checkUserInterrupt();
+  }
+  joinRoot();
+}
+
+// Sum the distances of each node and sort the rows of the matrix
+void NjTree::initRows()
+{
+  posNodes.resize( numSeqs );
+  nodePos.assign( 2 * numSeqs - 1, -1 );
+  activePos.resize( numSeqs );
+  for ( size_t i = 0; i < numSeqs; i++ )
+  {
+    posNodes[ i ]  = i;
+    nodePos[ i ]   = i;
+    activePos[ i ] = i;
+  }
+
+  // Sum the rows in the order of the condensed lower triangle
+  rowSums.assign( numSeqs, 0 );
+  const double *dist = dists.data();
+  for ( size_t j = 0; j < numSeqs; j++ )
+  {
+    for ( size_t i = j + 1; i < numSeqs; i++, dist++ )
+    {
+      rowSums[ i ] += *dist;
+      rowSums[ j ] += *dist;
+    }
+  }
+
+  // Row i of the lower triangle holds the distances to the nodes before
+  // it. The rows are filled a block at a time, so the part of each column
+  // of the triangle in a block is read in order
+  sortedRows.assign( 2 * numSeqs - 1, std::vector< SortedDist >() );
+  rowStarts.assign( 2 * numSeqs - 1, 0 );
+  size_t numBlocks = ( numSeqs + NJ_ROW_BLOCK - 1 ) / NJ_ROW_BLOCK;
+  tbb::parallel_for( size_t( 0 ), numBlocks, [&] ( size_t b )
+  {
+    size_t blockStart = b * NJ_ROW_BLOCK;
+    size_t blockEnd   = std::min( blockStart + NJ_ROW_BLOCK, numSeqs );
+    for ( size_t i = blockStart; i < blockEnd; i++ )
+      sortedRows[ i ].resize( i );
+    for ( size_t j = 0; j + 1 < blockEnd; j++ )
+    {
+      for ( size_t i = std::max( blockStart, j + 1 ); i < blockEnd; i++ )
+      {
+        sortedRows[ i ][ j ].dist = dists[ getIdx( i, j ) ];
+        sortedRows[ i ][ j ].node = j;
+      }
+    }
+    for ( size_t i = blockStart; i < blockEnd; i++ )
+      std::sort( sortedRows[ i ].begin(), sortedRows[ i ].end(),
+        SortedDistLess() );
+  });
+}
+
+// Find the pair of positions with the smallest Q-value
+void NjTree::findMinPair( size_t &minI, size_t &minJ )
+{
+  size_t numActive = activePos.size();
+  double scale     = numActive - 2;
+  double maxSum    = -std::numeric_limits< double >::infinity();
+  for ( size_t pos : activePos ) maxSum = std::max( maxSum, rowSums[ pos ] );
+
+  // Start the search from an upper bound of the Q-value of the first node
+  // that is not joined in each sorted row, skipping the joined nodes at
+  // the start. The pair of the bound is found again by the search, so no
+  // pair is set until then
+  double seedQ = std::numeric_limits< double >::infinity();
+  for ( size_t i : activePos )
+  {
+    const std::vector< SortedDist > &row = sortedRows[ posNodes[ i ] ];
+    size_t &rowStart = rowStarts[ posNodes[ i ] ];
+    while ( rowStart < row.size() && nodePos[ row[ rowStart ].node ] < 0 )
+      rowStart++;
+    if ( rowStart == row.size() ) continue;
+    double dist    = row[ rowStart ].dist;
+    double maxDist = dist + std::fabs( dist ) * NJ_FLOAT_ERR;
+    seedQ = std::min( seedQ, scale * maxDist -
+      ( rowSums[ i ] + rowSums[ nodePos[ row[ rowStart ].node ] ] ) );
+  }
+  size_t noPair = std::numeric_limits< size_t >::max();
+
+  // Find the best pair in each block of rows. Pairs with the same Q-value
+  // are ordered by position so the result does not depend on the blocks
+  size_t numBlocks = std::min( NJ_SEARCH_BLOCKS, numActive );
+  std::vector< double > blockQs( numBlocks, seedQ );
+  std::vector< size_t > blockIs( numBlocks, noPair );
+  std::vector< size_t > blockJs( numBlocks, noPair );
+  tbb::parallel_for( size_t( 0 ), numBlocks, [&] ( size_t b )
+  {
+    size_t blockStart = b * numActive / numBlocks;
+    size_t blockEnd   = ( b + 1 ) * numActive / numBlocks;
+    double bestQ      = seedQ;
+    size_t bestI      = noPair;
+    size_t bestJ      = noPair;
+    for ( size_t a = blockStart; a < blockEnd; a++ )
+    {
+      size_t i = activePos[ a ];
+      const std::vector< SortedDist > &row = sortedRows[ posNodes[ i ] ];
+      size_t rowStart = rowStarts[ posNodes[ i ] ];
+
+      for ( size_t k = rowStart; k < row.size(); k++ )
+      {
+        // No later distance in the row can have a smaller Q-value. The
+        // sums are added before they are subtracted, as for the Q-value,
+        // so rounding can not make the bound larger
+        double dist    = row[ k ].dist;
+        double minDist = dist - std::fabs( dist ) * NJ_FLOAT_ERR;
+        if ( scale * minDist - ( rowSums[ i ] + maxSum ) > bestQ ) break;
+
+        int32_t j = nodePos[ row[ k ].node ];
+        if ( j < 0 ) continue;
+
+        // Only read the exact distance from the matrix if the pair could
+        // have a smaller Q-value than the best so far
+        double pairSum = rowSums[ i ] + rowSums[ j ];
+        if ( scale * minDist - pairSum > bestQ ) continue;
+        double q = scale * getDist( i, j ) - pairSum;
+        size_t pairI = std::min( i, (size_t) j );
+        size_t pairJ = std::max( i, (size_t) j );
+        if ( isBetterPair( q, pairI, pairJ, bestQ, bestI, bestJ ) )
+        {
+          bestQ = q;
+          bestI = pairI;
+          bestJ = pairJ;
+        }
+      }
+    }
+    blockQs[ b ] = bestQ;
+    blockIs[ b ] = bestI;
+    blockJs[ b ] = bestJ;
+  });
+
+  size_t best = 0;
+  for ( size_t b = 1; b < numBlocks; b++ )
+  {
+    if ( isBetterPair( blockQs[ b ], blockIs[ b ], blockJs[ b ],
+         blockQs[ best ], blockIs[ best ], blockJs[ best ] ) )
+      best = b;
+  }
+  minI = blockIs[ best ];
+  minJ = blockJs[ best ];
+}
+
+// Join the nodes at two positions into a new node at position i
+void NjTree::joinPair( size_t i, size_t j )
+{
+  size_t  numActive = activePos.size();
+  int32_t nodeI     = posNodes[ i ];
+  int32_t nodeJ     = posNodes[ j ];
+  int32_t newNode   = numSeqs + ( numSeqs - numActive );
+  double  pairDist  = getDist( i, j );
+
+  // Branch lengths from the new node to the joined nodes
+  branchLens[ nodeI ] = 0.5 * pairDist +
+    ( rowSums[ i ] - rowSums[ j ] ) / ( 2.0 * ( numActive - 2 ) );
+  branchLens[ nodeJ ]   = pairDist - branchLens[ nodeI ];
+  leftNodes[ newNode ]  = nodeI;
+  rightNodes[ newNode ] = nodeJ;
+
+  // Remove the joined nodes
+  posNodes[ i ]     = newNode;
+  posNodes[ j ]     = -1;
+  nodePos[ nodeI ]  = -1;
+  nodePos[ nodeJ ]  = -1;
+  nodePos[ newNode ] = i;
+  activePos.erase(
+    std::lower_bound( activePos.begin(), activePos.end(), j ) );
+  std::vector< SortedDist >().swap( sortedRows[ nodeI ] );
+  std::vector< SortedDist >().swap( sortedRows[ nodeJ ] );
+
+  // Calculate the distances to the new node and update the sums of the
+  // other nodes
+  std::vector< SortedDist > &newRow = sortedRows[ newNode ];
+  newRow.resize( activePos.size() );
+  tbb::parallel_for( size_t( 0 ), activePos.size(), [&] ( size_t a )
+  {
+    size_t k = activePos[ a ];
+    if ( k == i )
+    {
+      newRow[ a ].dist = std::numeric_limits< float >::infinity();
+      newRow[ a ].node = newNode;
+      return;
+    }
+    double distI   = getDist( i, k );
+    double distJ   = getDist( j, k );
+    double newDist = 0.5 * ( distI + distJ - pairDist );
+    rowSums[ k ]  += newDist - distI - distJ;
+    dists[ i > k ? getIdx( i, k ) : getIdx( k, i ) ] = newDist;
+    newRow[ a ].dist = newDist;
+    newRow[ a ].node = posNodes[ k ];
+  });
+
+  // The sum is added in order so it does not depend on the threads
+  double newSum = 0;
+  for ( size_t k : activePos )
+    if ( k != i ) newSum += getDist( i, k );
+  rowSums[ i ] = newSum;
+
+  // The entry of the new node to itself is sorted to the end and removed
+  std::sort( newRow.begin(), newRow.end(), SortedDistLess() );
+  newRow.pop_back();
+}
+
+// Join the last two or three nodes at the root
+void NjTree::joinRoot()
+{
+  for ( size_t pos : activePos ) rootNodes.push_back( posNodes[ pos ] );
+  if ( activePos.size() == 2 )
+  {
+    double pairDist = getDist( activePos[ 0 ], activePos[ 1 ] );
+    branchLens[ rootNodes[ 0 ] ] = 0.5 * pairDist;
+    branchLens[ rootNodes[ 1 ] ] = 0.5 * pairDist;
+    return;
+  }
+
+  // Solve for the three branches from the distances between their ends
+  double distAB = getDist( activePos[ 0 ], activePos[ 1 ] );
+  double distAC = getDist( activePos[ 0 ], activePos[ 2 ] );
+  double distBC = getDist( activePos[ 1 ], activePos[ 2 ] );
+  branchLens[ rootNodes[ 0 ] ] = 0.5 * ( distAB + distAC - distBC );
+  branchLens[ rootNodes[ 1 ] ] = 0.5 * ( distAB + distBC - distAC );
+  branchLens[ rootNodes[ 2 ] ] = 0.5 * ( distAC + distBC - distAB );
+}
+
+// Remove the entries to nodes that were joined from the sorted rows
+void NjTree::compactRows()
+{
+  tbb::parallel_for( size_t( 0 ), activePos.size(), [&] ( size_t a )
+  {
+    int32_t node = posNodes[ activePos[ a ] ];
+    std::vector< SortedDist > &row = sortedRows[ node ];
+    row.erase( std::remove_if( row.begin(), row.end(),
+      [&] ( const SortedDist &entry ) { return nodePos[ entry.node ] < 0; } ),
+      row.end() );
+    std::vector< SortedDist >( row ).swap( row );
+    rowStarts[ node ] = 0;
+  });
+}
+
+// Write the name of a leaf
+void NjTree::writeLabel( std::ostream &os, const std::string &label )
+{
+  if ( label.find_first_of( " ()[]':;,\t" ) == std::string::npos )
+  {
+    os << label;
+    return;
+  }
+
+  // Quote the label and double any quotes in it
+  os << '\'';
+  for ( char ch : label )
+  {
+    if ( ch == '\'' ) os << '\'';
+    os << ch;
+  }
+  os << '\'';
+}
+
+// Return the tree in Newick format
+std::string NjTree::getNewick() const
+{
+  if ( rootNodes.empty() ) Rcpp::stop( "The tree has not been built" );
+  std::ostringstream os;
+  os.precision( 10 );
+
+  // Walk the tree with a stack, since the tree can be as deep as the
+  // number of sequences. A node is pushed a second time, as its bitwise
+  // complement, to close it after its children are written
+  std::vector< int32_t > nodeStack;
+  os << '(';
+  for ( size_t r = rootNodes.size(); r-- > 0; )
+  {
+    nodeStack.push_back( ~rootNodes[ r ] );
+    nodeStack.push_back( rootNodes[ r ] );
+  }
+  bool isFirst = true;
+  while ( !nodeStack.empty() )
+  {
+    int32_t node = nodeStack.back();
+    nodeStack.pop_back();
+    if ( node < 0 )
+    {
+      node = ~node;
+      if ( node >= (int32_t) numSeqs ) os << ')';
+      else writeLabel( os, seqNames[ node ] );
+      os << ':' << branchLens[ node ];
+      isFirst = false;
+      continue;
+    }
+    if ( !isFirst ) os << ',';
+    isFirst = true;
+    if ( node >= (int32_t) numSeqs )
+    {
+      os << '(';
+      nodeStack.push_back( ~rightNodes[ node ] );
+      nodeStack.push_back( rightNodes[ node ] );
+      nodeStack.push_back( ~leftNodes[ node ] );
+      nodeStack.push_back( leftNodes[ node ] );
+    }
+  }
+  os << ");\n";
+  return os.str();
+}
+
+// Write the tree in Newick format
+bool NjTree::writeNewick( const std::string &treePath ) const
+{
+  std::ofstream ofs( treePath.c_str() );
+  if ( ofs.fail() ) return false;
+  ofs << getNewick();
+  ofs.close();
+  return !ofs.fail();
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// NjTree
+// Ryan D. Crawford
+// 2020/12/17
+// -----------------------------------------------------------------------------
+// This class builds a neighbor joining tree from the condensed lower
+// triangle of a distance matrix and writes it in Newick format. The pair
+// to join is found with the bounded search of RapidNJ: the distances of
+// each row are kept sorted, so the search of a row stops once the smallest
+// Q-value that the remaining distances could have is larger than the best
+// found so far. Each pair is stored in the sorted row of only one of its
+// nodes, the node that was created last. The rows are searched in
+// parallel, and the distances to a new node are calculated in parallel.
+// A new node takes the place of the first node that it joins in the
+// distance matrix, so no more memory is needed than the condensed matrix
+// and the sorted rows.
+// -----------------------------------------------------------------------------
+
+#ifndef _NJ_TREE_
+#define _NJ_TREE_
+
+// A distance in a sorted row and the node that the distance is to
+struct SortedDist
+{
+  float   dist;
+  int32_t node;
+};
+
+class NjTree
+{
+public:
+
+  // Default ctor: no distances
+  NjTree(): numSeqs( 0 )
+  { ; }
+
+  // Set the distances from a square distance matrix. The names of the
+  // sequences are the row names of the matrix
+  void setDistMat( Rcpp::NumericMatrix distMat );
+
+  // Set the distances from an R "dist" object of doubles or integers
+  void setDist( Rcpp::RObject distObj );
+
+  // Set the distances from a binary distance file. Returns false if the
+  // file could not be opened
+  bool readDistFile( const std::string &distPath );
+
+  // Join the sequences into an unrooted tree
+  void buildTree();
+
+  // Return the tree in Newick format
+  std::string getNewick() const;
+
+  // Write the tree in Newick format. Returns false if the file could not be
+  // written
+  bool writeNewick( const std::string &treePath ) const;
+
+private:
+
+  // Number of sequences in the distance matrix
+  size_t numSeqs;
+
+  // Names of the sequences. Sequences without names are numbered
+  std::vector< std::string > seqNames;
+
+  // Condensed lower triangle of the distance matrix between the nodes at
+  // each position
+  std::vector< double > dists;
+
+  // Sum of the distances of the node at each position to the other nodes
+  std::vector< double > rowSums;
+
+  // Node at each position of the matrix. The leaves are nodes 0 to n - 1
+  // and the joined nodes are numbered in the order they were created.
+  // Negative once the position is no longer used
+  std::vector< int32_t > posNodes;
+
+  // Position of each node in the matrix, negative once the node is joined
+  std::vector< int32_t > nodePos;
+
+  // Positions in the matrix that are still used, in increasing order
+  std::vector< size_t > activePos;
+
+  // The distances of each node that is not joined to the nodes that were
+  // created before it, sorted by distance
+  std::vector< std::vector< SortedDist > > sortedRows;
+
+  // Index of the first entry of each sorted row that may be to a node
+  // that is not joined
+  std::vector< size_t > rowStarts;
+
+  // The two children of each joined node and the length of the branch to
+  // the parent of every node
+  std::vector< int32_t > leftNodes;
+  std::vector< int32_t > rightNodes;
+  std::vector< double >  branchLens;
+
+  // The nodes joined at the root of the unrooted tree
+  std::vector< int32_t > rootNodes;
+
+  // Return the distance between the nodes at two positions
+  inline double getDist( size_t i, size_t j ) const
+  {
+    return i > j ? dists[ getIdx( i, j ) ] : dists[ getIdx( j, i ) ];
+  }
+
+  // Return the index in the condensed lower triangle for i > j
+  inline size_t getIdx( size_t i, size_t j ) const
+  {
+    return j * ( 2 * numSeqs - j - 1 ) / 2 + ( i - j - 1 );
+  }
+
+  // Set the names of the sequences, numbering the sequences if there are
+  // no names
+  void setSeqNames( size_t numSeqs, const std::vector< std::string > &names );
+
+  // Sum the distances of each node and sort the rows of the matrix
+  void initRows();
+
+  // Find the pair of positions with the smallest Q-value
+  void findMinPair( size_t &minI, size_t &minJ );
+
+  // Join the nodes at two positions into a new node at position i
+  void joinPair( size_t i, size_t j );
+
+  // Join the last two or three nodes at the root
+  void joinRoot();
+
+  // Remove the entries to nodes that were joined from the sorted rows
+  void compactRows();
+
+  // Write the name of a leaf, quoted if it has characters that are not
+  // allowed in a Newick label
+  static void writeLabel( std::ostream &os, const std::string &label );
+};
+#endif
+
+// -----------------------------------------------------------------------------
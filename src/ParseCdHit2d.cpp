@@ -0,0 +1,62 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <fstream>
+
+// -----------------------------------------------------------------------------
+// ParseCdHit2d
+// Ryan D. Crawford
+// 2020/11/16
+// -----------------------------------------------------------------------------
+// This function parses the clusters output by cd-hit-2d, where the new genes
+// are compared to the representative genes of the existing clusters. Each
+// cluster begins with the representative gene from the first database,
+// marked with a '*', followed by any of the new genes assigned to it. A
+// character vector is returned with the representative gene id assigned to
+// each new gene, named by the new gene ids.
+// -----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+Rcpp::CharacterVector ParseCdHit2d( const std::string &cdHitClstFile )
+{
+  std::ifstream ifs( cdHitClstFile.c_str() );
+  if ( !ifs.is_open() ) Rcpp::stop( "Cannot open the cd-hit-2d results..." );
+
+  std::string line;         // Current line in the results
+  std::string repId;        // Representative gene of the current cluster
+  std::vector< std::string > newIds;
+  std::vector< std::string > newIdReps;
+
+  while ( getline( ifs, line ) )
+  {
+    // A new cluster is starting
+    if ( line[0] == '>' )
+    {
+      repId.clear();
+      continue;
+    }
+
+    // Extract the gene id from the line: "0	350aa, >fig|id.peg.1... *"
+    int start = line.find( '>' ) + 1;
+    int len   = line.find( "..." ) - start;
+    std::string geneId = line.substr( start, len );
+
+    // The representative is always the gene from the first database
+    if ( line.find( "... *" ) != std::string::npos )
+    {
+      repId = geneId;
+    }
+    else if ( !repId.empty() )
+    {
+      newIds.push_back( geneId );
+      newIdReps.push_back( repId );
+    }
+  }
+  ifs.close();
+
+  Rcpp::CharacterVector geneReps = Rcpp::wrap( newIdReps );
+  geneReps.attr( "names" )       = Rcpp::wrap( newIds );
+
+  return geneReps;
+}
+
+// -----------------------------------------------------------------------------
@@ -8,6 +8,24 @@
 
 using namespace Rcpp;
 
+// AddSeqsToGeneAlgns
+Rcpp::List AddSeqsToGeneAlgns(const std::string& algnPath, const std::vector< int >& genePositions, const Rcpp::List& addSeqs, const Rcpp::List& addIds, const std::string& algnDir, const std::string& mafftOpts, int threadVal, double maxMemMb);
+RcppExport SEXP _cognac_AddSeqsToGeneAlgns(SEXP algnPathSEXP, SEXP genePositionsSEXP, SEXP addSeqsSEXP, SEXP addIdsSEXP, SEXP algnDirSEXP, SEXP mafftOptsSEXP, SEXP threadValSEXP, SEXP maxMemMbSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type algnPath(algnPathSEXP);
+    Rcpp::traits::input_parameter< const std::vector< int >& >::type genePositions(genePositionsSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type addSeqs(addSeqsSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type addIds(addIdsSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type algnDir(algnDirSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type mafftOpts(mafftOptsSEXP);
+    Rcpp::traits::input_parameter< int >::type threadVal(threadValSEXP);
+    Rcpp::traits::input_parameter< double >::type maxMemMb(maxMemMbSEXP);
+    rcpp_result_gen = Rcpp::wrap(AddSeqsToGeneAlgns(algnPath, genePositions, addSeqs, addIds, algnDir, mafftOpts, threadVal, maxMemMb));
+    return rcpp_result_gen;
+END_RCPP
+}
 // CalcAlgnSubMatrix
 Rcpp::NumericMatrix CalcAlgnSubMatrix(std::vector< std::string > seqs);
 RcppExport SEXP _cognac_CalcAlgnSubMatrix(SEXP seqsSEXP) {
@@ -20,7 +38,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // CalcAlgnPartitionDists
-std::list < Rcpp::NumericMatrix > CalcAlgnPartitionDists(std::string msaPath, std::string method, std::vector< int > genePartitions);
+Rcpp::NumericVector CalcAlgnPartitionDists(std::string msaPath, std::string method, std::vector< int > genePartitions);
 RcppExport SEXP _cognac_CalcAlgnPartitionDists(SEXP msaPathSEXP, SEXP methodSEXP, SEXP genePartitionsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -32,26 +50,53 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// ConcatenateAlignments
-void ConcatenateAlignments(Rcpp::StringVector& concatAlgn, const Rcpp::StringVector& algn);
-RcppExport SEXP _cognac_ConcatenateAlignments(SEXP concatAlgnSEXP, SEXP algnSEXP) {
+// CalcPartitionVariability
+std::vector< double > CalcPartitionVariability(std::string msaPath, std::vector< int > genePartitions);
+RcppExport SEXP _cognac_CalcPartitionVariability(SEXP msaPathSEXP, SEXP genePartitionsSEXP) {
 BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::StringVector& >::type concatAlgn(concatAlgnSEXP);
-    Rcpp::traits::input_parameter< const Rcpp::StringVector& >::type algn(algnSEXP);
-    ConcatenateAlignments(concatAlgn, algn);
-    return R_NilValue;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< std::vector< int > >::type genePartitions(genePartitionsSEXP);
+    rcpp_result_gen = Rcpp::wrap(CalcPartitionVariability(msaPath, genePartitions));
+    return rcpp_result_gen;
+END_RCPP
+}
+// CreateAlgnCountMats
+Rcpp::NumericVector CreateAlgnCountMats(std::string msaPath, bool byCodon);
+RcppExport SEXP _cognac_CreateAlgnCountMats(SEXP msaPathSEXP, SEXP byCodonSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< bool >::type byCodon(byCodonSEXP);
+    rcpp_result_gen = Rcpp::wrap(CreateAlgnCountMats(msaPath, byCodon));
+    return rcpp_result_gen;
+END_RCPP
+}
+// CreateAlgnDist
+Rcpp::RObject CreateAlgnDist(std::string msaPath, std::string method, std::string storage);
+RcppExport SEXP _cognac_CreateAlgnDist(SEXP msaPathSEXP, SEXP methodSEXP, SEXP storageSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< std::string >::type storage(storageSEXP);
+    rcpp_result_gen = Rcpp::wrap(CreateAlgnDist(msaPath, method, storage));
+    return rcpp_result_gen;
 END_RCPP
 }
 // CreateAlgnDistMat
-Rcpp::NumericMatrix CreateAlgnDistMat(std::string msaPath, std::string method);
-RcppExport SEXP _cognac_CreateAlgnDistMat(SEXP msaPathSEXP, SEXP methodSEXP) {
+Rcpp::NumericMatrix CreateAlgnDistMat(std::string msaPath, std::string method, bool sparse);
+RcppExport SEXP _cognac_CreateAlgnDistMat(SEXP msaPathSEXP, SEXP methodSEXP, SEXP sparseSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
     Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
-    rcpp_result_gen = Rcpp::wrap(CreateAlgnDistMat(msaPath, method));
+    Rcpp::traits::input_parameter< bool >::type sparse(sparseSEXP);
+    rcpp_result_gen = Rcpp::wrap(CreateAlgnDistMat(msaPath, method, sparse));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -69,13 +114,14 @@ BEGIN_RCPP
 END_RCPP
 }
 // CreateCoreGenomeDistMat
-Rcpp::NumericMatrix CreateCoreGenomeDistMat(std::string msaPath);
-RcppExport SEXP _cognac_CreateCoreGenomeDistMat(SEXP msaPathSEXP) {
+Rcpp::NumericMatrix CreateCoreGenomeDistMat(std::string msaPath, bool sparse);
+RcppExport SEXP _cognac_CreateCoreGenomeDistMat(SEXP msaPathSEXP, SEXP sparseSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
-    rcpp_result_gen = Rcpp::wrap(CreateCoreGenomeDistMat(msaPath));
+    Rcpp::traits::input_parameter< bool >::type sparse(sparseSEXP);
+    rcpp_result_gen = Rcpp::wrap(CreateCoreGenomeDistMat(msaPath, sparse));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -156,7 +202,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // GetAlgnQualScores
-std::vector< double > GetAlgnQualScores(std::string msaPath, std::string method, int stepVal, int windowSize);
+Rcpp::NumericMatrix GetAlgnQualScores(std::string msaPath, std::string method, int stepVal, int windowSize);
 RcppExport SEXP _cognac_GetAlgnQualScores(SEXP msaPathSEXP, SEXP methodSEXP, SEXP stepValSEXP, SEXP windowSizeSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -216,6 +262,17 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// ParseCdHit2d
+Rcpp::CharacterVector ParseCdHit2d(const std::string& cdHitClstFile);
+RcppExport SEXP _cognac_ParseCdHit2d(SEXP cdHitClstFileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type cdHitClstFile(cdHitClstFileSEXP);
+    rcpp_result_gen = Rcpp::wrap(ParseCdHit2d(cdHitClstFile));
+    return rcpp_result_gen;
+END_RCPP
+}
 // ParseFasta
 Rcpp::CharacterVector ParseFasta(const std::string& faPath);
 RcppExport SEXP _cognac_ParseFasta(SEXP faPathSEXP) {
@@ -227,6 +284,38 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// ReadAlgnDistFile
+Rcpp::NumericVector ReadAlgnDistFile(std::string distPath);
+RcppExport SEXP _cognac_ReadAlgnDistFile(SEXP distPathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type distPath(distPathSEXP);
+    rcpp_result_gen = Rcpp::wrap(ReadAlgnDistFile(distPath));
+    return rcpp_result_gen;
+END_RCPP
+}
+// RunAlgnJobs
+Rcpp::List RunAlgnJobs(const Rcpp::List& repSeqs, const Rcpp::List& identLists, const Rcpp::List& clustGeneIds, const std::vector< std::string >& genomeNames, const std::string& algnDir, const std::string& mafftOpts, int threadVal, double maxMemMb, const std::string& cacheDir, bool fastAlgn, const std::string& concatAlgnPath);
+RcppExport SEXP _cognac_RunAlgnJobs(SEXP repSeqsSEXP, SEXP identListsSEXP, SEXP clustGeneIdsSEXP, SEXP genomeNamesSEXP, SEXP algnDirSEXP, SEXP mafftOptsSEXP, SEXP threadValSEXP, SEXP maxMemMbSEXP, SEXP cacheDirSEXP, SEXP fastAlgnSEXP, SEXP concatAlgnPathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type repSeqs(repSeqsSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type identLists(identListsSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type clustGeneIds(clustGeneIdsSEXP);
+    Rcpp::traits::input_parameter< const std::vector< std::string >& >::type genomeNames(genomeNamesSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type algnDir(algnDirSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type mafftOpts(mafftOptsSEXP);
+    Rcpp::traits::input_parameter< int >::type threadVal(threadValSEXP);
+    Rcpp::traits::input_parameter< double >::type maxMemMb(maxMemMbSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type cacheDir(cacheDirSEXP);
+    Rcpp::traits::input_parameter< bool >::type fastAlgn(fastAlgnSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type concatAlgnPath(concatAlgnPathSEXP);
+    rcpp_result_gen = Rcpp::wrap(RunAlgnJobs(repSeqs, identLists, clustGeneIds, genomeNames, algnDir, mafftOpts, threadVal, maxMemMb, cacheDir, fastAlgn, concatAlgnPath));
+    return rcpp_result_gen;
+END_RCPP
+}
 // TranslateAaAlgnToDna
 void TranslateAaAlgnToDna(const Rcpp::DataFrame& gffData, const std::string& faPath, const std::vector< int >& genePositions, const std::string& genomeName, const std::string& aaAlgn, const std::string& outputFile);
 RcppExport SEXP _cognac_TranslateAaAlgnToDna(SEXP gffDataSEXP, SEXP faPathSEXP, SEXP genePositionsSEXP, SEXP genomeNameSEXP, SEXP aaAlgnSEXP, SEXP outputFileSEXP) {
@@ -242,6 +331,85 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// UpdateAlgnDistFile
+void UpdateAlgnDistFile(std::string msaPath, std::string distPath, std::string outPath, std::string method, bool sparse);
+RcppExport SEXP _cognac_UpdateAlgnDistFile(SEXP msaPathSEXP, SEXP distPathSEXP, SEXP outPathSEXP, SEXP methodSEXP, SEXP sparseSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type distPath(distPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type outPath(outPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< bool >::type sparse(sparseSEXP);
+    UpdateAlgnDistFile(msaPath, distPath, outPath, method, sparse);
+    return R_NilValue;
+END_RCPP
+}
+// UpdateAlgnDistMat
+Rcpp::RObject UpdateAlgnDistMat(std::string msaPath, Rcpp::RObject distMat, std::string method, bool sparse);
+RcppExport SEXP _cognac_UpdateAlgnDistMat(SEXP msaPathSEXP, SEXP distMatSEXP, SEXP methodSEXP, SEXP sparseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type distMat(distMatSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< bool >::type sparse(sparseSEXP);
+    rcpp_result_gen = Rcpp::wrap(UpdateAlgnDistMat(msaPath, distMat, method, sparse));
+    return rcpp_result_gen;
+END_RCPP
+}
+// WriteAlgnDistFile
+void WriteAlgnDistFile(std::string msaPath, std::string outPath, std::string method, std::string storage);
+RcppExport SEXP _cognac_WriteAlgnDistFile(SEXP msaPathSEXP, SEXP outPathSEXP, SEXP methodSEXP, SEXP storageSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type outPath(outPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< std::string >::type storage(storageSEXP);
+    WriteAlgnDistFile(msaPath, outPath, method, storage);
+    return R_NilValue;
+END_RCPP
+}
+// WriteAlgnFile
+void WriteAlgnFile(std::string msaPath, std::string outPath, std::vector< int > genePositions, bool addCols);
+RcppExport SEXP _cognac_WriteAlgnFile(SEXP msaPathSEXP, SEXP outPathSEXP, SEXP genePositionsSEXP, SEXP addColsSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type outPath(outPathSEXP);
+    Rcpp::traits::input_parameter< std::vector< int > >::type genePositions(genePositionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type addCols(addColsSEXP);
+    WriteAlgnFile(msaPath, outPath, genePositions, addCols);
+    return R_NilValue;
+END_RCPP
+}
+// WriteNjTree
+void WriteNjTree(Rcpp::RObject dists, std::string treePath);
+RcppExport SEXP _cognac_WriteNjTree(SEXP distsSEXP, SEXP treePathSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type dists(distsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type treePath(treePathSEXP);
+    WriteNjTree(dists, treePath);
+    return R_NilValue;
+END_RCPP
+}
+// WriteTiledAlgnDistFile
+void WriteTiledAlgnDistFile(std::string msaPath, std::string outPath, std::string method, std::string storage, int blockSize);
+RcppExport SEXP _cognac_WriteTiledAlgnDistFile(SEXP msaPathSEXP, SEXP outPathSEXP, SEXP methodSEXP, SEXP storageSEXP, SEXP blockSizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type msaPath(msaPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type outPath(outPathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< std::string >::type storage(storageSEXP);
+    Rcpp::traits::input_parameter< int >::type blockSize(blockSizeSEXP);
+    WriteTiledAlgnDistFile(msaPath, outPath, method, storage, blockSize);
+    return R_NilValue;
+END_RCPP
+}
 
 // validate (ensure exported C++ functions exist before calling them)
 static int _cognac_RcppExport_validate(const char* sig) { 
@@ -260,12 +428,15 @@ RcppExport SEXP _cognac_RcppExport_registerCCallable() {
 }
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_cognac_AddSeqsToGeneAlgns", (DL_FUNC) &_cognac_AddSeqsToGeneAlgns, 8},
     {"_cognac_CalcAlgnSubMatrix", (DL_FUNC) &_cognac_CalcAlgnSubMatrix, 1},
     {"_cognac_CalcAlgnPartitionDists", (DL_FUNC) &_cognac_CalcAlgnPartitionDists, 3},
-    {"_cognac_ConcatenateAlignments", (DL_FUNC) &_cognac_ConcatenateAlignments, 2},
-    {"_cognac_CreateAlgnDistMat", (DL_FUNC) &_cognac_CreateAlgnDistMat, 2},
+    {"_cognac_CalcPartitionVariability", (DL_FUNC) &_cognac_CalcPartitionVariability, 2},
+    {"_cognac_CreateAlgnCountMats", (DL_FUNC) &_cognac_CreateAlgnCountMats, 2},
+    {"_cognac_CreateAlgnDist", (DL_FUNC) &_cognac_CreateAlgnDist, 3},
+    {"_cognac_CreateAlgnDistMat", (DL_FUNC) &_cognac_CreateAlgnDistMat, 3},
     {"_cognac_CreateCognacRunData", (DL_FUNC) &_cognac_CreateCognacRunData, 4},
-    {"_cognac_CreateCoreGenomeDistMat", (DL_FUNC) &_cognac_CreateCoreGenomeDistMat, 1},
+    {"_cognac_CreateCoreGenomeDistMat", (DL_FUNC) &_cognac_CreateCoreGenomeDistMat, 2},
     {"_cognac_DeletePartitions", (DL_FUNC) &_cognac_DeletePartitions, 4},
     {"_cognac_ExtractGenomeNameFromPath", (DL_FUNC) &_cognac_ExtractGenomeNameFromPath, 1},
     {"_cognac_GetGenomeNameWithExt", (DL_FUNC) &_cognac_GetGenomeNameWithExt, 2},
@@ -275,8 +446,17 @@ static const R_CallMethodDef CallEntries[] = {
     {"_cognac_GetAlgnQualScores", (DL_FUNC) &_cognac_GetAlgnQualScores, 4},
     {"_cognac_GetGenomeId", (DL_FUNC) &_cognac_GetGenomeId, 1},
     {"_cognac_ParseCdHit", (DL_FUNC) &_cognac_ParseCdHit, 4},
+    {"_cognac_ParseCdHit2d", (DL_FUNC) &_cognac_ParseCdHit2d, 1},
     {"_cognac_ParseFasta", (DL_FUNC) &_cognac_ParseFasta, 1},
+    {"_cognac_ReadAlgnDistFile", (DL_FUNC) &_cognac_ReadAlgnDistFile, 1},
+    {"_cognac_RunAlgnJobs", (DL_FUNC) &_cognac_RunAlgnJobs, 11},
     {"_cognac_TranslateAaAlgnToDna", (DL_FUNC) &_cognac_TranslateAaAlgnToDna, 6},
+    {"_cognac_UpdateAlgnDistFile", (DL_FUNC) &_cognac_UpdateAlgnDistFile, 5},
+    {"_cognac_UpdateAlgnDistMat", (DL_FUNC) &_cognac_UpdateAlgnDistMat, 4},
+    {"_cognac_WriteAlgnDistFile", (DL_FUNC) &_cognac_WriteAlgnDistFile, 4},
+    {"_cognac_WriteAlgnFile", (DL_FUNC) &_cognac_WriteAlgnFile, 4},
+    {"_cognac_WriteNjTree", (DL_FUNC) &_cognac_WriteNjTree, 2},
+    {"_cognac_WriteTiledAlgnDistFile", (DL_FUNC) &_cognac_WriteTiledAlgnDistFile, 5},
     {"_cognac_RcppExport_registerCCallable", (DL_FUNC) &_cognac_RcppExport_registerCCallable, 0},
     {NULL, NULL, 0}
 };
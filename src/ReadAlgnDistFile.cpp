@@ -0,0 +1,40 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "DistFile.h"
+
+// -----------------------------------------------------------------------------
+//  ReadAlgnDistFile
+//  Ryan D. Crawford
+//  2020/12/14
+//  ----------------------------------------------------------------------------
+//' @name ReadAlgnDistFile
+//' @title Read Binary Alignment Distance Matrix
+//' @description
+//'   This function reads a binary distance file written by
+//'   WriteAlgnDistFile and returns the distances as an R "dist" object.
+//' @param distPath Path to the binary distance matrix
+//' @return A dist object
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+Rcpp::NumericVector ReadAlgnDistFile( std::string distPath )
+{
+  DistFile distFile;
+  if ( !distFile.open( distPath ) )
+    Rcpp::stop( "Unable to open the distance file " + distPath );
+  if ( !distFile.isComplete() )
+    Rcpp::stop( "The distance file " + distPath + " is not complete. Run " +
+      "WriteTiledAlgnDistFile again to resume the calculation" );
+
+  // Copy the distances to a vector of doubles and set the attributes of
+  // the dist object
+  Rcpp::NumericVector dists(
+    DistOutput::getCondensedSize( distFile.getNumSeqs() ) );
+  distFile.copyDists( dists.begin() );
+  DistOutput::setDistAttrs( dists, distFile.getSeqNames(), "" );
+
+  return dists;
+}
+
+// -----------------------------------------------------------------------------
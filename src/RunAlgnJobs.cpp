@@ -0,0 +1,150 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <unordered_map>
+#include "AlgnJobScheduler.h"
+#include "GeneAlgn.h"
+#include "ConcatAlgnBuilder.h"
+
+// -----------------------------------------------------------------------------
+// RunAlgnJobs
+// Ryan D. Crawford
+// 2020/11/02
+// -----------------------------------------------------------------------------
+// This function takes lists with the sequences of the representative genes
+// in each cluster and the identical genes of each representative, and aligns
+// each cluster with mafft using the native job scheduler. Clusters with
+// fewer than two representatives are not aligned. If a cache directory is
+// input, previously created alignments are reused. If "fastAlgn" is true,
+// clusters of nearly identical genes are aligned with the native center-star
+// aligner instead of mafft. The aligned rows are then put in the order of the
+// genomes, using the first gene of each genome in the cluster, and the genes
+// are concatenated into a single alignment which is written to the output
+// path. Clusters that were not aligned are not included. A list is returned
+// with the end position of each gene in the alignment ("genePositions") and
+// a logical vector indicating that each cluster was included ("isAligned").
+// -----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+Rcpp::List RunAlgnJobs(
+  const Rcpp::List  &repSeqs,      // List with the sequences in each cluster
+  const Rcpp::List  &identLists,   // Identical genes of each representative
+  const Rcpp::List  &clustGeneIds, // Gene ids in each cluster in order
+  const std::vector< std::string > &genomeNames, // Genomes in the analysis
+  const std::string &algnDir,      // Directory to write the temporary files
+  const std::string &mafftOpts,    // Arguments for mafft
+  int               threadVal,     // Number of threads available
+  double            maxMemMb,      // Memory limit for concurrent jobs
+  const std::string &cacheDir,     // Directory of the alignment cache
+  bool              fastAlgn,      // Align similar genes without mafft
+  const std::string &concatAlgnPath // Path to write the alignment
+  )
+{
+  int nClusts = repSeqs.size();
+  if ( identLists.size() != nClusts || clustGeneIds.size() != nClusts )
+    Rcpp::stop( "There must be identical genes and gene ids for each cluster" );
+
+  // Create the jobs for each cluster that needs to be aligned. The
+  // sequences are copied out of the R objects so the worker threads never
+  // touch the R API
+  AlgnJobScheduler scheduler(
+    algnDir, mafftOpts, threadVal, maxMemMb, cacheDir, fastAlgn );
+  std::vector< std::vector< std::string > > repIds( nClusts );
+  std::vector< std::vector< std::vector< std::string > > > identIds( nClusts );
+  std::vector< std::vector< std::string > > geneIds( nClusts );
+  std::vector< int > jobIdx( nClusts, -1 );
+  for ( int i = 0; i < nClusts; i++ )
+  {
+    std::vector< std::string > seqs = Rcpp::as<
+      std::vector< std::string > >( repSeqs[ i ] );
+    Rcpp::List identList = identLists[ i ];
+    repIds[ i ] = Rcpp::as< std::vector< std::string > >( identList.names() );
+    for ( int j = 0; j < identList.size(); j++ )
+      identIds[ i ].push_back(
+        Rcpp::as< std::vector< std::string > >( identList[ j ] ) );
+    geneIds[ i ] = Rcpp::as< std::vector< std::string > >( clustGeneIds[ i ] );
+
+    if ( seqs.size() > 1 )
+    {
+      jobIdx[ i ] = scheduler.getJobs().size();
+      scheduler.addJob( i + 1, repIds[ i ], seqs );
+    }
+  }
+
+  // Run the jobs on the thread pool
+  scheduler.runJobs();
+
+  if ( scheduler.getNumCached() )
+    Rcpp::Rcout << "  -- " << scheduler.getNumCached()
+                << " gene alignments were found in the cache" << std::endl;
+  if ( scheduler.getNumFastAlgn() )
+    Rcpp::Rcout << "  -- " << scheduler.getNumFastAlgn()
+                << " genes were aligned without mafft" << std::endl;
+
+  // Report any clusters that could not be aligned
+  std::vector< int > failed = scheduler.getFailedJobs();
+  if ( failed.size() )
+  {
+    std::string errStr = "mafft failed to align gene cluster(s):";
+    for ( auto clustIdx : failed ) errStr += ' ' + std::to_string( clustIdx );
+    Rcpp::stop( errStr );
+  }
+
+  // Put the aligned rows of each cluster in the order of the genomes
+  GenomeIndex genomeIndex( genomeNames );
+  std::vector< GeneAlgn > geneAlgns( nClusts );
+  std::vector< char > isOrdered( nClusts, true );
+  tbb::parallel_for( 0, nClusts, [&] ( int i )
+  {
+    if ( jobIdx[ i ] < 0 ) return;
+    AlgnJob &job = scheduler.getJobs()[ jobIdx[ i ] ];
+
+    // Find the aligned row of each representative and its identical genes
+    std::unordered_map< std::string, int > repRow;
+    for ( size_t j = 0; j < job.algnIds.size(); j++ )
+      repRow[ job.algnIds[ j ] ] = j;
+
+    std::unordered_map< std::string, int > geneRow;
+    for ( size_t j = 0; j < repIds[ i ].size(); j++ )
+    {
+      auto it = repRow.find( repIds[ i ][ j ] );
+      int row = it == repRow.end() ? -1 : it->second;
+      geneRow[ repIds[ i ][ j ] ] = row;
+      for ( auto &geneId : identIds[ i ][ j ] ) geneRow[ geneId ] = row;
+    }
+
+    std::vector< int > geneReps( geneIds[ i ].size(), -1 );
+    for ( size_t j = 0; j < geneIds[ i ].size(); j++ )
+    {
+      auto it = geneRow.find( geneIds[ i ][ j ] );
+      if ( it != geneRow.end() ) geneReps[ j ] = it->second;
+    }
+
+    isOrdered[ i ] = geneAlgns[ i ].setAlgn(
+      job.algn, geneIds[ i ], geneReps, genomeIndex );
+
+    // The rows are copied into the gene alignment, so free the job's copy
+    std::vector< std::string >().swap( job.algn );
+  });
+
+  for ( int i = 0; i < nClusts; i++ )
+  {
+    if ( !isOrdered[ i ] )
+      Rcpp::stop( "Unable to order the alignment of gene cluster " +
+        std::to_string( i + 1 ) );
+  }
+
+  // Concatenate the gene alignments and write the alignment
+  ConcatAlgnBuilder concatAlgn( genomeNames );
+  concatAlgn.build( geneAlgns );
+  if ( !concatAlgn.writeFasta( concatAlgnPath ) )
+    Rcpp::stop( "Unable to write the alignment to: " + concatAlgnPath );
+
+  return Rcpp::List::create(
+    Rcpp::_[ "genePositions" ] = concatAlgn.getGenePositions(),
+    Rcpp::_[ "isAligned" ]     = concatAlgn.getIsIncluded()
+    );
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,248 @@
+// [[Rcpp::plugins(cpp11)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <algorithm>
+#include <cstring>
+#include "SparseAlgn.h"
+
+// -----------------------------------------------------------------------------
+// SparseAlgn
+// Ryan D. Crawford
+// 2020/12/16
+// -----------------------------------------------------------------------------
+
+// Number of positions counted together when finding the consensus
+static const size_t CONSENSUS_BLOCK = 64;
+
+// Encode the alignment
+void SparseAlgn::encode( const std::vector< const char * > &seqs, size_t len )
+{
+  if ( len > UINT32_MAX )
+    Rcpp::stop( "The alignment is too long to encode as differences" );
+  numSeqs  = seqs.size();
+  algnLen  = len;
+  alphabet = findAlphabet( seqs, len );
+  if ( alphabet == ALPHABET_DNA ) encodeCodes< DnaAlphabet >( seqs );
+  else encodeCodes< ProteinAlphabet >( seqs );
+}
+
+// Encode the alignment with the codes of the alphabet
+template< class Alphabet >
+void SparseAlgn::encodeCodes( const std::vector< const char * > &seqs )
+{
+  findConsensus< Alphabet >( seqs );
+
+  // Find the differences and missing intervals of each sequence in parallel
+  const uint8_t *codes = Alphabet::getCodes();
+  std::vector< std::vector< uint32_t > > seqDiffPos( numSeqs );
+  std::vector< std::vector< uint8_t > >  seqDiffSyms( numSeqs );
+  std::vector< std::vector< uint32_t > > seqMissStarts( numSeqs );
+  std::vector< std::vector< uint32_t > > seqMissEnds( numSeqs );
+  tbb::parallel_for( size_t( 0 ), numSeqs, [&] ( size_t s )
+  {
+    const char *seq = seqs[ s ];
+    for ( size_t i = 0; i < algnLen; i++ )
+    {
+      uint8_t code = codes[ (uint8_t) seq[ i ] ];
+      if ( code >= Alphabet::NUM_RESIDUES )
+      {
+        size_t start = i;
+        while ( i + 1 < algnLen &&
+                codes[ (uint8_t) seq[ i + 1 ] ] >= Alphabet::NUM_RESIDUES )
+          i++;
+        seqMissStarts[ s ].push_back( start );
+        seqMissEnds[ s ].push_back( i + 1 );
+      }
+      else if ( code != consensus[ i ] )
+      {
+        seqDiffPos[ s ].push_back( i );
+        seqDiffSyms[ s ].push_back( code );
+      }
+    }
+  });
+
+  // Store the lists of every sequence one after the other
+  diffIdx.assign( numSeqs + 1, 0 );
+  missIdx.assign( numSeqs + 1, 0 );
+  for ( size_t s = 0; s < numSeqs; s++ )
+  {
+    diffIdx[ s + 1 ] = diffIdx[ s ] + seqDiffPos[ s ].size();
+    missIdx[ s + 1 ] = missIdx[ s ] + seqMissStarts[ s ].size();
+  }
+  diffPos.resize( diffIdx.back() );
+  diffSyms.resize( diffIdx.back() );
+  missStarts.resize( missIdx.back() );
+  missEnds.resize( missIdx.back() );
+  tbb::parallel_for( size_t( 0 ), numSeqs, [&] ( size_t s )
+  {
+    std::copy( seqDiffPos[ s ].begin(), seqDiffPos[ s ].end(),
+      diffPos.begin() + diffIdx[ s ] );
+    std::copy( seqDiffSyms[ s ].begin(), seqDiffSyms[ s ].end(),
+      diffSyms.begin() + diffIdx[ s ] );
+    std::copy( seqMissStarts[ s ].begin(), seqMissStarts[ s ].end(),
+      missStarts.begin() + missIdx[ s ] );
+    std::copy( seqMissEnds[ s ].begin(), seqMissEnds[ s ].end(),
+      missEnds.begin() + missIdx[ s ] );
+  });
+}
+
+// Find the consensus residue at each position
+template< class Alphabet >
+void SparseAlgn::findConsensus( const std::vector< const char * > &seqs )
+{
+  // Count the codes of a block of positions at a time, so the counts of
+  // the block stay in cache while the rows are read. A position without a
+  // residue is given the gap code
+  const uint8_t *codes = Alphabet::getCodes();
+  consensus.assign( algnLen, Alphabet::GAP_CODE );
+  size_t numBlocks = ( algnLen + CONSENSUS_BLOCK - 1 ) / CONSENSUS_BLOCK;
+  tbb::parallel_for( size_t( 0 ), numBlocks, [&] ( size_t b )
+  {
+    size_t bStart = b * CONSENSUS_BLOCK;
+    size_t bEnd   = std::min( bStart + CONSENSUS_BLOCK, algnLen );
+    std::vector< uint32_t > counts( CONSENSUS_BLOCK * Alphabet::NUM_CODES, 0 );
+    for ( auto seq : seqs )
+      for ( size_t i = bStart; i < bEnd; i++ )
+        counts[ ( i - bStart ) * Alphabet::NUM_CODES +
+          codes[ (uint8_t) seq[ i ] ] ]++;
+
+    for ( size_t i = bStart; i < bEnd; i++ )
+    {
+      const uint32_t *posCounts =
+        counts.data() + ( i - bStart ) * Alphabet::NUM_CODES;
+      uint32_t maxCount = 0;
+      for ( int c = 0; c < Alphabet::NUM_RESIDUES; c++ )
+      {
+        if ( posCounts[ c ] <= maxCount ) continue;
+        maxCount       = posCounts[ c ];
+        consensus[ i ] = c;
+      }
+    }
+  });
+}
+
+// Count the mismatches and the shared valid sites between two sequences
+void SparseAlgn::countDiffs( size_t i, size_t j, size_t start, size_t len,
+  uint64_t &numMismatch, uint64_t &numShared
+  ) const
+{
+  size_t end = start + len;
+
+  // Every position is shared unless it is missing in either sequence
+  numShared = len - countMissing( i, start, end ) -
+    countMissing( j, start, end ) + countBothMissing( i, j, start, end );
+
+  // Merge the differences of the two sequences in the window. A position
+  // that only one sequence differs at is a mismatch unless the other
+  // sequence is missing there, as the other sequence has the consensus
+  const uint32_t *iPos = diffPos.data() + diffIdx[ i ];
+  const uint32_t *jPos = diffPos.data() + diffIdx[ j ];
+  const uint32_t *iEnd = diffPos.data() + diffIdx[ i + 1 ];
+  const uint32_t *jEnd = diffPos.data() + diffIdx[ j + 1 ];
+  iPos = std::lower_bound( iPos, iEnd, start );
+  jPos = std::lower_bound( jPos, jEnd, start );
+  iEnd = std::lower_bound( iPos, iEnd, end );
+  jEnd = std::lower_bound( jPos, jEnd, end );
+
+  // The missing intervals of each sequence are walked with the merge
+  size_t iMiss    = findMiss( i, start );
+  size_t jMiss    = findMiss( j, start );
+  size_t iMissEnd = missIdx[ i + 1 ];
+  size_t jMissEnd = missIdx[ j + 1 ];
+  auto isMissing = [&] ( size_t &miss, size_t missEnd, uint32_t pos )
+  {
+    while ( miss < missEnd && missEnds[ miss ] <= pos ) miss++;
+    return miss < missEnd && missStarts[ miss ] <= pos;
+  };
+
+  numMismatch = 0;
+  while ( iPos < iEnd || jPos < jEnd )
+  {
+    if ( jPos == jEnd || ( iPos < iEnd && *iPos < *jPos ) )
+    {
+      numMismatch += !isMissing( jMiss, jMissEnd, *iPos );
+      iPos++;
+    }
+    else if ( iPos == iEnd || *jPos < *iPos )
+    {
+      numMismatch += !isMissing( iMiss, iMissEnd, *jPos );
+      jPos++;
+    }
+    else
+    {
+      numMismatch += diffSyms[ iPos - diffPos.data() ] !=
+        diffSyms[ jPos - diffPos.data() ];
+      iPos++;
+      jPos++;
+    }
+  }
+}
+
+// Return the index of the first missing interval of sequence i that ends
+// after "start"
+size_t SparseAlgn::findMiss( size_t i, size_t start ) const
+{
+  auto it = std::upper_bound( missEnds.begin() + missIdx[ i ],
+    missEnds.begin() + missIdx[ i + 1 ], start );
+  return it - missEnds.begin();
+}
+
+// Return the number of positions in the window that are missing in
+// sequence i
+uint64_t SparseAlgn::countMissing( size_t i, size_t start, size_t end ) const
+{
+  uint64_t numMissing = 0;
+  for ( size_t m = findMiss( i, start ); m < missIdx[ i + 1 ]; m++ )
+  {
+    if ( missStarts[ m ] >= end ) break;
+    size_t mStart = std::max< size_t >( missStarts[ m ], start );
+    size_t mEnd   = std::min< size_t >( missEnds[ m ], end );
+    if ( mEnd > mStart ) numMissing += mEnd - mStart;
+  }
+  return numMissing;
+}
+
+// Return the number of positions in the window that are missing in both
+// sequences
+uint64_t SparseAlgn::countBothMissing( size_t i, size_t j, size_t start,
+  size_t end
+  ) const
+{
+  // Intersect the sorted intervals of the two sequences
+  uint64_t numMissing = 0;
+  size_t   iMiss      = findMiss( i, start );
+  size_t   jMiss      = findMiss( j, start );
+  while ( iMiss < missIdx[ i + 1 ] && jMiss < missIdx[ j + 1 ] )
+  {
+    if ( missStarts[ iMiss ] >= end || missStarts[ jMiss ] >= end ) break;
+    size_t mStart = std::max< size_t >(
+      std::max( missStarts[ iMiss ], missStarts[ jMiss ] ), start );
+    size_t mEnd   = std::min< size_t >(
+      std::min( missEnds[ iMiss ], missEnds[ jMiss ] ), end );
+    if ( mEnd > mStart ) numMissing += mEnd - mStart;
+    if ( missEnds[ iMiss ] < missEnds[ jMiss ] ) iMiss++;
+    else jMiss++;
+  }
+  return numMissing;
+}
+
+// Return the number of sequences that were encoded
+size_t SparseAlgn::getNumSeqs() const
+{
+  return numSeqs;
+}
+
+// Return the consensus of the alignment
+std::vector< char > SparseAlgn::getConsensus() const
+{
+  const char *residues    = getResidues( alphabet );
+  size_t      numResidues = std::strlen( residues );
+  std::vector< char > consensusSeq( algnLen, '-' );
+  for ( size_t i = 0; i < algnLen; i++ )
+    if ( consensus[ i ] < numResidues )
+      consensusSeq[ i ] = residues[ consensus[ i ] ];
+  return consensusSeq;
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,99 @@
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <cstdint>
+#include "Alphabet.h"
+
+// -----------------------------------------------------------------------------
+// SparseAlgn
+// Ryan D. Crawford
+// 2020/12/16
+// -----------------------------------------------------------------------------
+// This class encodes an alignment as the differences of each sequence from
+// the consensus of the alignment. Each position is coded with the alphabet
+// of the alignment, and the consensus is the most common residue at each
+// position. Each sequence is stored as the sorted positions and residue
+// codes where it differs from the consensus, and the sorted intervals
+// where it has a gap or an unknown residue. Two sequences are
+// the same at every position that is in neither list, so the mismatches
+// and shared sites of a pair are counted by merging their lists. When the
+// sequences have few differences from the consensus, as in the core genome
+// alignment of an outbreak, this is much faster than comparing every
+// position of the alignment.
+// -----------------------------------------------------------------------------
+
+#ifndef _SPARSE_ALGN_
+#define _SPARSE_ALGN_
+class SparseAlgn
+{
+public:
+
+  // Default ctor: an empty alignment
+  SparseAlgn(): numSeqs( 0 ), algnLen( 0 ), alphabet( ALPHABET_DNA )
+  { ; }
+
+  // Encode the alignment from pointers to the start of each sequence and
+  // the length of the alignment
+  void encode( const std::vector< const char * > &seqs, size_t len );
+
+  // Count the mismatches and the shared valid sites between two sequences
+  // in the window of the alignment starting at "start" of length "len"
+  void countDiffs( size_t i, size_t j, size_t start, size_t len,
+    uint64_t &numMismatch, uint64_t &numShared ) const;
+
+  // Return the number of sequences that were encoded
+  size_t getNumSeqs() const;
+
+  // Return the consensus of the alignment. Positions without a valid
+  // residue in any sequence are a gap
+  std::vector< char > getConsensus() const;
+
+private:
+
+  // Number of sequences in the alignment
+  size_t numSeqs;
+
+  // Length of the alignment
+  size_t algnLen;
+
+  // Alphabet of the alignment
+  AlgnAlphabet alphabet;
+
+  // The code of the most common residue at each position
+  std::vector< uint8_t > consensus;
+
+  // The positions and residue codes where each sequence differs from the
+  // consensus. The differences of sequence i start at diffIdx[ i ]
+  std::vector< uint32_t > diffPos;
+  std::vector< uint8_t >  diffSyms;
+  std::vector< size_t >   diffIdx;
+
+  // The start and end of the intervals with a gap or an unknown residue in
+  // each sequence. The intervals of sequence i start at missIdx[ i ]
+  std::vector< uint32_t > missStarts;
+  std::vector< uint32_t > missEnds;
+  std::vector< size_t >   missIdx;
+
+  // Encode the alignment with the codes of the alphabet
+  template< class Alphabet >
+  void encodeCodes( const std::vector< const char * > &seqs );
+
+  // Find the consensus residue at each position
+  template< class Alphabet >
+  void findConsensus( const std::vector< const char * > &seqs );
+
+  // Return the index of the first missing interval of sequence i that ends
+  // after "start"
+  size_t findMiss( size_t i, size_t start ) const;
+
+  // Return the number of positions in the window that are in the missing
+  // intervals of sequence i
+  uint64_t countMissing( size_t i, size_t start, size_t end ) const;
+
+  // Return the number of positions in the window that are in the missing
+  // intervals of both sequences
+  uint64_t countBothMissing( size_t i, size_t j, size_t start,
+    size_t end ) const;
+};
+#endif
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,117 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include <fstream>
+#include "TiledAlgnDist.h"
+#include "MsaDistance.h"
+
+// -----------------------------------------------------------------------------
+// TiledAlgnDist
+// Ryan D. Crawford
+// 2020/12/15
+// -----------------------------------------------------------------------------
+
+// Calculate the distances and write them to the distance file
+void TiledAlgnDist::writeDistFile( const std::string &outPath,
+  const std::string &distType, DistStorage storage, size_t blockSize
+  )
+{
+  if ( !MsaDistance::isCountMethod( distType ) )
+    Rcpp::stop( "Only the distances from the counts of the mismatches can " +
+      std::string( "be calculated by tiles" ) );
+  DistOutput::checkStorage( distType, storage );
+  if ( !blockSize ) Rcpp::stop( "The block size must be greater than zero" );
+
+  rowReader.indexAlgn();
+  DistFile distFile;
+  openDistFile( distFile, outPath, storage, blockSize );
+
+  // The tiles are numbered by the row block and then the column block
+  size_t numSeqs   = rowReader.getNumSeqs();
+  size_t algnLen   = rowReader.getAlgnLen();
+  blockSize        = distFile.getBlockSize();
+  size_t numBlocks = ( numSeqs + blockSize - 1 ) / blockSize;
+
+  std::vector< char >         iBuf, jBuf;
+  std::vector< const char * > iRows, jRows;
+  for ( size_t iBlock = 0; iBlock < numBlocks; iBlock++ )
+  {
+    // Skip the row block if all of its tiles are done
+    size_t firstTile = iBlock * ( iBlock + 1 ) / 2;
+    size_t numDone   = 0;
+    while ( numDone <= iBlock && distFile.isTileDone( firstTile + numDone ) )
+      numDone++;
+    if ( numDone > iBlock ) continue;
+
+    size_t iStart = iBlock * blockSize;
+    size_t iCount = std::min( blockSize, numSeqs - iStart );
+    rowReader.readRows( iStart, iCount, iBuf, iRows );
+
+    for ( size_t jBlock = 0; jBlock <= iBlock; jBlock++ )
+    {
+      if ( distFile.isTileDone( firstTile + jBlock ) ) continue;
+
+      // The rows of the column block are followed by the rows of the row
+      // block, and each row is written to the file at its sequence index
+      size_t jStart = jBlock * blockSize;
+      std::vector< const char * > tileRows;
+      std::vector< size_t >       seqIds;
+      if ( jBlock != iBlock )
+      {
+        rowReader.readRows( jStart, blockSize, jBuf, jRows );
+        tileRows = jRows;
+        for ( size_t j = 0; j < blockSize; j++ )
+          seqIds.push_back( jStart + j );
+      }
+      tileRows.insert( tileRows.end(), iRows.begin(), iRows.end() );
+      for ( size_t i = 0; i < iCount; i++ ) seqIds.push_back( iStart + i );
+
+      MsaDistance msaDistance( tileRows, algnLen, distFile.getOutput() );
+      msaDistance.seqIds = seqIds;
+      msaDistance.setDistFunc( distType );
+      if ( jBlock == iBlock ) msaDistance.calcDistances();
+      else msaDistance.calcCrossDistances( blockSize );
+
+      if ( !distFile.setTileDone( firstTile + jBlock ) )
+        Rcpp::stop( "Unable to write the distances to " + outPath );
+
+      // The tiles that are done are kept if the calculation is interrupted
+      Rcpp::checkUserInterrupt();
+    }
+  }
+
+  if ( !distFile.close() )
+    Rcpp::stop( "Unable to write the distances to " + outPath );
+}
+
+// Open a distance file to resume or create a new distance file
+void TiledAlgnDist::openDistFile( DistFile &distFile,
+  const std::string &outPath, DistStorage storage, size_t blockSize
+  )
+{
+  // Create the file if it does not exist
+  if ( !std::ifstream( outPath.c_str() ).good() )
+  {
+    if ( !distFile.create(
+           outPath, rowReader.getSeqNames(), storage, blockSize ) )
+      Rcpp::stop( "Unable to create the distance file " + outPath );
+    return;
+  }
+
+  // An existing file is only resumed if it was written by tiles for the
+  // same alignment. It is never overwritten, as it may hold the distances
+  // of a long calculation
+  if ( !distFile.open( outPath, true ) || !distFile.getBlockSize() ||
+       distFile.getStorage() != storage ||
+       distFile.getSeqNames() != rowReader.getSeqNames() )
+    Rcpp::stop( "The file " + outPath + " exists and is not a distance " +
+      "file of this alignment with the same storage type" );
+
+  size_t numDone = 0;
+  for ( size_t t = 0; t < distFile.getNumTiles(); t++ )
+    numDone += distFile.isTileDone( t );
+  Rcpp::Rcout << "  -- Resuming with " << numDone << " of "
+              << distFile.getNumTiles() << " tiles done" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
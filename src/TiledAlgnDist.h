@@ -0,0 +1,50 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "AlgnRowReader.h"
+#include "DistFile.h"
+
+// -----------------------------------------------------------------------------
+// TiledAlgnDist
+// Ryan D. Crawford
+// 2020/12/15
+// -----------------------------------------------------------------------------
+// This class calculates the distance matrix of an alignment that is too
+// large to hold in memory. The sequences are split into blocks, and the
+// lower triangle of the matrix into tiles of pairs of blocks. The tiles are
+// calculated one at a time with only the rows of the two blocks in memory,
+// and the distances are written to a mapped distance file. The file marks
+// each tile once its distances are on disk, so if the calculation is
+// interrupted it is resumed from the first tile that is not done. Only the
+// "raw" and "shared" distances are supported, as the other distances need
+// the substitution matrix of the whole alignment.
+// -----------------------------------------------------------------------------
+
+#ifndef _TILED_ALGN_DIST_
+#define _TILED_ALGN_DIST_
+class TiledAlgnDist
+{
+public:
+
+  // Value ctor: assigns the path to the alignment in fasta or binary format
+  TiledAlgnDist( const std::string &msaPath ): rowReader( msaPath )
+  { ; }
+
+  // Calculate the distances and write them to the distance file. If the
+  // file exists it must have been written for the same alignment, and
+  // only the tiles that are not done are calculated
+  void writeDistFile( const std::string &outPath, const std::string &distType,
+    DistStorage storage, size_t blockSize );
+
+private:
+
+  // Reads the blocks of rows from the alignment
+  AlgnRowReader rowReader;
+
+  // Open a distance file to resume or create a new distance file
+  void openDistFile( DistFile &distFile, const std::string &outPath,
+    DistStorage storage, size_t blockSize );
+};
+#endif
+
+// -----------------------------------------------------------------------------
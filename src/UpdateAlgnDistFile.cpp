@@ -0,0 +1,52 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "MultiSeqAlgn.h"
+
+// -----------------------------------------------------------------------------
+//  UpdateAlgnDistFile
+//  Ryan D. Crawford
+//  2020/12/16
+//  ----------------------------------------------------------------------------
+//' @name UpdateAlgnDistFile
+//' @title Update Binary Alignment Distance Matrix
+//' @description
+//'   This function updates a binary distance file after new sequences are
+//'   added to the end of the alignment. The distances between the
+//'   sequences that were already in the alignment are copied from the
+//'   input file, and only the distances between the new sequences and
+//'   every other sequence are calculated. The distances are stored with
+//'   the same type as the input file.
+//' @param msaPath Path to the extended alignment in fasta or binary format
+//' @param distPath Path to the binary distance matrix of the sequences that
+//'   were already in the alignment. These must be the first sequences of
+//'   the extended alignment, in the same order.
+//' @param outPath Path to write the updated binary distance matrix. Must
+//'   be different from distPath.
+//' @param method Method used to calculate the distances: "raw", "shared",
+//'   "pDist", "JC69", "K2P" or "poisson". "pDist" is the same as "shared".
+//'   The "normProb" and "logLike" distances cannot be updated, as the
+//'   substitution matrix changes when sequences are added.
+//' @param sparse Logical to count the distances from the differences of
+//'   each sequence from the consensus of the alignment. Not for the "K2P"
+//'   method. Defaults to false.
+//' @return void
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+void UpdateAlgnDistFile( std::string msaPath, std::string distPath,
+  std::string outPath, std::string method, bool sparse=false
+  )
+{
+  // Create the msa class object
+  MultiSeqAlgn multiSeqAlgn( msaPath );
+
+  // Read in the alignment and check that this is a valid alignmnet
+  multiSeqAlgn.parseMsa();
+
+  if ( !multiSeqAlgn.updateDistFile( distPath, outPath, method, sparse ) )
+    Rcpp::stop( "Unable to write the distance matrix to " + outPath );
+}
+
+// -----------------------------------------------------------------------------
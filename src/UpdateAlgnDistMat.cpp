@@ -0,0 +1,53 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "MultiSeqAlgn.h"
+
+// -----------------------------------------------------------------------------
+//  UpdateAlgnDistMat
+//  Ryan D. Crawford
+//  2020/12/16
+//  ----------------------------------------------------------------------------
+//' @name UpdateAlgnDistMat
+//' @title Update Algnment Distance Matrix
+//' @description
+//'   This function updates the distance matrix of an alignment after new
+//'   sequences are added to the end of the alignment, as done by
+//'   AddGenomesToAlgn. The distances between the sequences that were
+//'   already in the alignment are copied from the input matrix, and only
+//'   the distances between the new sequences and every other sequence are
+//'   calculated.
+//' @param msaPath Path to the extended alignment in fasta or binary format
+//' @param distMat Distance matrix or dist object of the sequences that were
+//'   already in the alignment. These must be the first sequences of the
+//'   extended alignment, in the same order.
+//' @param method Method used to calculate the distances: "raw", "shared",
+//'   "pDist", "JC69", "K2P" or "poisson". "pDist" is the same as "shared".
+//'   The "normProb" and "logLike" distances cannot be updated, as the
+//'   substitution matrix changes when sequences are added.
+//' @param sparse Logical to count the distances from the differences of
+//'   each sequence from the consensus of the alignment. Not for the "K2P"
+//'   method. Defaults to false.
+//' @return The updated distance matrix, or dist object if a dist object
+//'   was input
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+Rcpp::RObject UpdateAlgnDistMat( std::string msaPath, Rcpp::RObject distMat,
+  std::string method, bool sparse=false
+  )
+{
+  // Create the msa class object
+  MultiSeqAlgn multiSeqAlgn( msaPath );
+
+  // Read in the alignment and check that this is a valid alignmnet
+  multiSeqAlgn.parseMsa();
+
+  if ( distMat.inherits( "dist" ) )
+    return multiSeqAlgn.updateDist( distMat, method, sparse );
+  return multiSeqAlgn.updateDistMat(
+    Rcpp::as< Rcpp::NumericMatrix >( distMat ), method, sparse );
+}
+
+// -----------------------------------------------------------------------------
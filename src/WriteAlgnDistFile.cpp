@@ -0,0 +1,51 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "MultiSeqAlgn.h"
+#include "DistOutput.h"
+
+// -----------------------------------------------------------------------------
+//  WriteAlgnDistFile
+//  Ryan D. Crawford
+//  2020/12/14
+//  ----------------------------------------------------------------------------
+//' @name WriteAlgnDistFile
+//' @title Write Binary Alignment Distance Matrix
+//' @description
+//'   This function calculates the pairwise distances between the sequences
+//'   in a multiple sequence alignment and writes them directly to a binary
+//'   distance file. The file stores the lower triangle of the distance
+//'   matrix and is mapped into memory while it is written, so the distance
+//'   matrix is never held in memory. Stored as 32 bit values the file is a
+//'   quarter of the size of the matrix returned by CreateAlgnDistMat. The
+//'   file is read with ReadAlgnDistFile.
+//' @param msaPath Path to the alignment in fasta or binary format
+//' @param outPath Path to write the binary distance matrix
+//' @param method Method for calculating distance: "raw", "shared",
+//'   "pDist", "JC69", "K2P", "poisson", "normProb" or "logLike". "pDist"
+//'   is the same as "shared".
+//' @param storage Type used to store the distances: "double", "float",
+//'   "integer" or "uint32". Only the "raw" distances can be stored as
+//'   integers. Defaults to "float".
+//' @return void
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+void WriteAlgnDistFile( std::string msaPath, std::string outPath,
+  std::string method, std::string storage="float"
+  )
+{
+  DistStorage distStorage = DistOutput::parseStorage( storage );
+
+  // Create the msa class object
+  MultiSeqAlgn multiSeqAlgn( msaPath );
+
+  // Read in the alignment and check that this is a valid alignmnet
+  multiSeqAlgn.parseMsa();
+
+  if ( !multiSeqAlgn.writeDistFile( outPath, method, distStorage ) )
+    Rcpp::stop( "Unable to write the distance matrix to " + outPath );
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,53 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "MultiSeqAlgn.h"
+
+// -----------------------------------------------------------------------------
+//  WriteAlgnFile
+//  Ryan D. Crawford
+//  2020/12/08
+//  ----------------------------------------------------------------------------
+//' @name WriteAlgnFile
+//' @title Write Binary Alignment
+//' @description
+//'   This function converts a multiple sequence alignment to the binary
+//'   alignment format. The binary alignment stores the sequence names, the
+//'   gene partitions and the alignment in a form that is mapped into memory
+//'   instead of being parsed, so it can be opened instantly and shared by
+//'   several R sessions. The binary alignment can be input to any of the
+//'   functions that take the path to an alignment.
+//' @param msaPath Path to the alignment in fasta or binary format
+//' @param outPath Path to write the binary alignment
+//' @param genePositions Vector with the end position of each gene partition
+//'   in the alignment. If empty, the partitions of the input alignment are
+//'   kept when it is a binary alignment.
+//' @param addCols Logical to also store the alignment by column, which is
+//'   used to calculate the column statistics when filtering positions.
+//'   Doubles the size of the file. Defaults to true.
+//' @return void
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+void WriteAlgnFile( std::string msaPath, std::string outPath,
+  std::vector< int > genePositions, bool addCols=true
+  )
+{
+  // Create the msa class object
+  MultiSeqAlgn multiSeqAlgn( msaPath );
+
+  // Read in the alignment and check that this is a valid alignmnet
+  multiSeqAlgn.parseMsa();
+
+  if ( !genePositions.size() ) genePositions = multiSeqAlgn.getPartitions();
+  if ( genePositions.size() &&
+       genePositions.back() != (int) multiSeqAlgn.getAlgnLen() )
+    Rcpp::stop( "The last gene partition must end at the end of the "
+      "alignment" );
+
+  if ( !multiSeqAlgn.writeAlgnFile( outPath, genePositions, addCols ) )
+    Rcpp::stop( "Unable to write the alignment to " + outPath );
+}
+
+// -----------------------------------------------------------------------------
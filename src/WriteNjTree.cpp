@@ -0,0 +1,54 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "NjTree.h"
+
+// -----------------------------------------------------------------------------
+//  WriteNjTree
+//  Ryan D. Crawford
+//  2020/12/17
+//  ----------------------------------------------------------------------------
+//' @name WriteNjTree
+//' @title Write Neighbor Joining Tree
+//' @description
+//'   This function builds a neighbor joining tree from a distance matrix
+//'   and writes it in Newick format. The pair of nodes to join is found
+//'   with the bounded search of RapidNJ on sorted rows of the distance
+//'   matrix, and the rows are searched and updated in parallel via the
+//'   RcppParallel package. The tree is the same as the neighbor joining
+//'   tree from ape::nj, but is built without the copies of the matrix in R
+//'   and is fast enough for tens of thousands of genomes. The tree can be
+//'   read with ape::read.tree.
+//' @param dists Distance matrix, dist object, or path to a binary distance
+//'   file written by WriteAlgnDistFile
+//' @param treePath Path to write the tree in Newick format
+//' @return void
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+void WriteNjTree( Rcpp::RObject dists, std::string treePath )
+{
+  NjTree njTree;
+  if ( TYPEOF( dists ) == STRSXP )
+  {
+    std::string distPath = Rcpp::as< std::string >( dists );
+    if ( !njTree.readDistFile( distPath ) )
+      Rcpp::stop( "Unable to open the distance file " + distPath );
+  }
+  else if ( dists.inherits( "dist" ) )
+  {
+    njTree.setDist( dists );
+  }
+  else
+  {
+    njTree.setDistMat( Rcpp::as< Rcpp::NumericMatrix >( dists ) );
+  }
+
+  // Join the sequences and write the tree
+  njTree.buildTree();
+  if ( !njTree.writeNewick( treePath ) )
+    Rcpp::stop( "Unable to write the tree to " + treePath );
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,50 @@
+// [[Rcpp::depends(RcppParallel)]]
+// [[Rcpp::plugins(cpp11)]]
+#include <Rcpp.h>
+#include "TiledAlgnDist.h"
+#include "DistOutput.h"
+
+// -----------------------------------------------------------------------------
+//  WriteTiledAlgnDistFile
+//  Ryan D. Crawford
+//  2020/12/15
+//  ----------------------------------------------------------------------------
+//' @name WriteTiledAlgnDistFile
+//' @title Write Binary Alignment Distance Matrix by Tiles
+//' @description
+//'   This function calculates the pairwise distances between the sequences
+//'   of an alignment that is too large to hold in memory and writes them to
+//'   a binary distance file. The sequences are split into blocks, and the
+//'   distances between each pair of blocks are calculated with only the
+//'   rows of the two blocks in memory, about 3 * blockSize * alignment
+//'   length bytes. Once the distances of a pair of blocks are written to
+//'   disk the pair is marked as done in the file. If the calculation is
+//'   interrupted, calling the function again with the same arguments
+//'   resumes from the pairs that are not done. The file is read with
+//'   ReadAlgnDistFile.
+//' @param msaPath Path to the alignment in fasta or binary format
+//' @param outPath Path to write the binary distance matrix. If the file
+//'   exists the calculation is resumed.
+//' @param method Method for calculating distance: "raw" or "shared".
+//' @param storage Type used to store the distances: "double", "float",
+//'   "integer" or "uint32". Only the "raw" distances can be stored as
+//'   integers. Defaults to "float".
+//' @param blockSize Number of sequences in a block. Defaults to 1024. The
+//'   block size of a file that is resumed is kept.
+//' @return void
+//' @export
+//  ----------------------------------------------------------------------------
+
+// [[Rcpp::export]]
+void WriteTiledAlgnDistFile( std::string msaPath, std::string outPath,
+  std::string method, std::string storage="float", int blockSize=1024
+  )
+{
+  DistStorage distStorage = DistOutput::parseStorage( storage );
+  if ( blockSize <= 0 ) Rcpp::stop( "The block size must be positive" );
+
+  TiledAlgnDist tiledAlgnDist( msaPath );
+  tiledAlgnDist.writeDistFile( outPath, method, distStorage, blockSize );
+}
+
+// -----------------------------------------------------------------------------